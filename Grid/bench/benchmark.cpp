@@ -0,0 +1,156 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <vector>
+#include "FEMSolver.h"
+#include "Grid.h"
+#include "LinearSolver.h"
+#include "Logger.h"
+#include "SparseMatrix.h"
+
+using std::vector;
+using std::unique_ptr;
+using std::make_unique;
+
+// Material and boundary data of data/data.txt; only the mesh size changes between runs.
+namespace {
+
+const double conductivity = 25.0;
+const double alfa = 300.0;
+const double ambient_temp = 1200.0;
+const double initial_temp = 100.0;
+const double density = 7800.0;
+const double specific_heat = 700.0;
+const double time_step = 50.0;
+
+// Structured n x n mesh of the 0.1 m x 0.1 m square, with the solver set up the way
+// main.cpp does it except that nothing is written to results/.
+struct Problem {
+    unique_ptr<Grid> grid;
+    unique_ptr<FEMSolver> solver;
+    SparseMatrix H_global, C_global;
+    vector<double> P_global;
+    int nodes, elements;
+
+    Problem(int n, SolverType solver_type) {
+        Logger::set_level(LogLevel::Quiet);
+        grid = make_unique<Grid>(n * n, (n - 1) * (n - 1), n, n, 0.1, 0.1, MeshSource::Generated);
+        solver = make_unique<FEMSolver>(*grid, alfa, ambient_temp);
+        solver->set_solver(solver_type, 1e-10, 10000);
+        solver->set_write_intermediate(false);
+        nodes = grid->get_nodes_count();
+        elements = grid->get_elements_count();
+    }
+
+    void assemble() {
+        solver->calculate_local_matrices(conductivity, density, specific_heat);
+        solver->aggregate_Hbc_matrix(H_global, nodes);
+        solver->aggregate_C_matrix(C_global, nodes);
+        solver->calculate_P_vector(alfa, ambient_temp);
+        solver->aggregate_P_vector(P_global, nodes);
+    }
+};
+
+void set_element_rate(benchmark::State& state, const Problem& problem) {
+    state.counters["elements/s"] = benchmark::Counter(problem.elements, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["nodes"] = problem.nodes;
+}
+
+void set_dof_rate(benchmark::State& state, const Problem& problem) {
+    state.counters["DOF/s"] = benchmark::Counter(problem.nodes, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["nodes"] = problem.nodes;
+}
+
+void BM_calculate_Hbc_matrix(benchmark::State& state) {
+    Problem problem(state.range(0), SolverType::LDLT);
+    for (auto _ : state) {
+        problem.solver->calculate_Hbc_matrix(conductivity);
+    }
+    set_element_rate(state, problem);
+}
+
+void BM_calculate_C_matrix(benchmark::State& state) {
+    Problem problem(state.range(0), SolverType::LDLT);
+    for (auto _ : state) {
+        problem.solver->calculate_C_matrix(density, specific_heat);
+    }
+    set_element_rate(state, problem);
+}
+
+void BM_aggregate_Hbc_matrix(benchmark::State& state) {
+    Problem problem(state.range(0), SolverType::LDLT);
+    problem.solver->calculate_local_matrices(conductivity, density, specific_heat);
+    for (auto _ : state) {
+        problem.solver->aggregate_Hbc_matrix(problem.H_global, problem.nodes);
+    }
+    set_element_rate(state, problem);
+}
+
+void BM_aggregate_C_matrix(benchmark::State& state) {
+    Problem problem(state.range(0), SolverType::LDLT);
+    problem.solver->calculate_local_matrices(conductivity, density, specific_heat);
+    for (auto _ : state) {
+        problem.solver->aggregate_C_matrix(problem.C_global, problem.nodes);
+    }
+    set_element_rate(state, problem);
+}
+
+void BM_aggregate_P_vector(benchmark::State& state) {
+    Problem problem(state.range(0), SolverType::LDLT);
+    problem.solver->calculate_P_vector(alfa, ambient_temp);
+    for (auto _ : state) {
+        problem.solver->aggregate_P_vector(problem.P_global, problem.nodes);
+    }
+    set_element_rate(state, problem);
+}
+
+// Rescaled cached operators, the alternative to calculate_local_matrices + aggregate_* when
+// only the material or boundary scalars change.
+void BM_combine_operators(benchmark::State& state) {
+    Problem problem(state.range(0), SolverType::LDLT);
+    problem.solver->combine_operators(conductivity, density * specific_heat, alfa, ambient_temp, problem.H_global, problem.C_global, problem.P_global);
+    for (auto _ : state) {
+        problem.solver->combine_operators(conductivity, density * specific_heat, alfa, ambient_temp, problem.H_global, problem.C_global, problem.P_global);
+    }
+    set_element_rate(state, problem);
+}
+
+void BM_solve_system(benchmark::State& state, SolverType solver_type) {
+    Problem problem(state.range(0), solver_type);
+    problem.assemble();
+    vector<double> t_global;
+    for (auto _ : state) {
+        problem.solver->solve_system(problem.H_global, problem.P_global, t_global);
+    }
+    set_dof_rate(state, problem);
+}
+
+// One implicit step including the factorization of C/dt + H, as in a fresh simulate_time.
+void BM_simulate_time_step(benchmark::State& state, SolverType solver_type) {
+    Problem problem(state.range(0), solver_type);
+    problem.assemble();
+    for (auto _ : state) {
+        vector<double> t_initial(problem.nodes, initial_temp);
+        problem.solver->simulate_time(problem.H_global, problem.C_global, problem.P_global, t_initial, time_step, time_step);
+    }
+    set_dof_rate(state, problem);
+}
+
+}
+
+#define MESH_SIZES ->Arg(25)->Arg(50)->Arg(100)->Arg(200)->Unit(benchmark::kMillisecond)
+
+BENCHMARK(BM_calculate_Hbc_matrix) MESH_SIZES;
+BENCHMARK(BM_calculate_C_matrix) MESH_SIZES;
+BENCHMARK(BM_aggregate_Hbc_matrix) MESH_SIZES;
+BENCHMARK(BM_aggregate_C_matrix) MESH_SIZES;
+BENCHMARK(BM_aggregate_P_vector) MESH_SIZES;
+BENCHMARK(BM_combine_operators) MESH_SIZES;
+BENCHMARK_CAPTURE(BM_solve_system, ldlt, SolverType::LDLT) MESH_SIZES;
+BENCHMARK_CAPTURE(BM_solve_system, banded, SolverType::Banded) MESH_SIZES;
+BENCHMARK_CAPTURE(BM_solve_system, pcg_jacobi, SolverType::PCG_Jacobi) MESH_SIZES;
+BENCHMARK_CAPTURE(BM_solve_system, pcg_ic0, SolverType::PCG_IC0) MESH_SIZES;
+BENCHMARK_CAPTURE(BM_simulate_time_step, ldlt, SolverType::LDLT) MESH_SIZES;
+BENCHMARK_CAPTURE(BM_simulate_time_step, banded, SolverType::Banded) MESH_SIZES;
+BENCHMARK_CAPTURE(BM_simulate_time_step, pcg_ic0, SolverType::PCG_IC0) MESH_SIZES;
+
+BENCHMARK_MAIN();
@@ -0,0 +1,33 @@
+#ifndef BANDEDCHOLESKYSOLVER_H
+#define BANDEDCHOLESKYSOLVER_H
+
+#include <vector>
+#include "LinearSolver.h"
+#include "SparseMatrix.h"
+
+using std::vector;
+
+// Cholesky factorization L L^T of a symmetric positive definite band matrix. The half
+// bandwidth b is taken from the sparsity pattern, and row i of L is stored densely from
+// column i - b to i, so the factorization costs O(n b^2) and the solves O(n b). Meant for
+// structured meshes (b = nodes_per_row + 1) or meshes renumbered with --reorder rcm.
+class BandedCholeskySolver : public LinearSolver {
+private:
+    int n;
+    int bandwidth;
+    vector<double> band;
+    bool factorized;
+
+    double& at(int i, int j);
+    double at(int i, int j) const;
+
+public:
+    BandedCholeskySolver();
+    using LinearSolver::factorize;
+    bool factorize(const SparseMatrix& A) override;
+    bool solve(const vector<double>& b, vector<double>& x) override;
+    string name() const override;
+    int get_bandwidth() const;
+};
+
+#endif // BANDEDCHOLESKYSOLVER_H
@@ -0,0 +1,34 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::string;
+
+// State of a transient run after a completed time step. Temperatures are in the input node
+// numbering, so a checkpoint stays valid when the restarted run renumbers the nodes.
+// results_offset and frames_written describe the results file at that step.
+struct CheckpointState {
+    int64_t step;
+    double time;
+    double time_step;
+    double previous_step;
+    int64_t results_offset;
+    int64_t frames_written;
+    vector<double> t_current, t_previous;
+};
+
+// Binary layout (native little-endian): "FEMCHKP1", int64 nodes, int64 step, double time,
+// double time_step, double previous_step, int64 results_offset, int64 frames_written, then
+// t_current[nodes] and t_previous[nodes]. Written to <path>.tmp and renamed, so a crash while
+// writing leaves the previous checkpoint intact.
+class Checkpoint {
+public:
+    static bool write(const string& path, const CheckpointState& state);
+    static bool read(const string& path, size_t expected_nodes, CheckpointState& state);
+};
+
+#endif // CHECKPOINT_H
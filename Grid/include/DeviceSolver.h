@@ -0,0 +1,58 @@
+#ifndef DEVICESOLVER_H
+#define DEVICESOLVER_H
+
+#ifdef FEM_OFFLOAD
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Grid.h"
+#include "ResultWriter.h"
+#include "SparseMatrix.h"
+
+using std::vector;
+using std::string;
+
+// Transient pipeline on an OpenMP offload device (GPU through the compiler's nvptx or amdgcn
+// offloading; without a device the target regions run on the host). The mesh, the shape
+// function table and the CSR pattern are copied to the device once. The local H, C, Hbc and P
+// of every element are integrated there and scattered straight into the device CSR values,
+// and the implicit steps with Jacobi PCG run entirely in device memory: temperatures are
+// copied back only for the frames that are written.
+class DeviceSolver {
+private:
+    Grid& grid;
+    int nodes_count, elements_count, points_count;
+    vector<double> weight, N, dN_dxi, dN_deta;
+    vector<int> row_ptr, col_idx;
+    vector<double> H_values, C_values, A_values, P, inv_diagonal;
+    vector<double> t, b, r, z, p, Ap;
+    int nnz;
+    double solver_tolerance;
+    int solver_max_iterations;
+    int last_iterations;
+    string results_directory;
+
+    double dot(const double* x, const double* y) const;
+    void multiply(const double* values, const double* x, double* y) const;
+    bool solve();
+
+public:
+    DeviceSolver(Grid& grid, int integration_order);
+    ~DeviceSolver();
+    DeviceSolver(const DeviceSolver&) = delete;
+    DeviceSolver& operator=(const DeviceSolver&) = delete;
+    // Number of offload devices; 0 means the target regions fall back to the host.
+    static int get_devices_count();
+    void set_solver(double tolerance, int max_iterations);
+    void set_results_directory(const string& directory);
+    // Returns false when an element has a degenerate Jacobian.
+    bool assemble(double conductivity, double density_specific_heat, double alpha, double ambient_temperature);
+    // Fixed implicit steps; only the steps the output options write are copied back. Returns
+    // false when the results cannot be opened or a solve fails.
+    bool simulate_time(double initial_temperature, double time_step, double total_time, ResultFormat format, const OutputOptions& output);
+};
+
+#endif // FEM_OFFLOAD
+
+#endif // DEVICESOLVER_H
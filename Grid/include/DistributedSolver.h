@@ -0,0 +1,74 @@
+#ifndef DISTRIBUTEDSOLVER_H
+#define DISTRIBUTEDSOLVER_H
+
+#ifdef FEM_MPI
+
+#include <mpi.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Grid.h"
+#include "FEMSolver.h"
+#include "ResultWriter.h"
+#include "SparseMatrix.h"
+
+using std::vector;
+using std::string;
+using std::unique_ptr;
+
+// Domain decomposition over MPI. Rank r owns the nodes offsets[r] .. offsets[r + 1] - 1 of the
+// global numbering (contiguous ranges, which are compact with row by row or RCM numbering) and
+// keeps every element touching one of them, so the rows of its own nodes are assembled
+// completely without communication. Those elements form a local Grid: owned nodes first, in
+// global order, then the ghost nodes sorted by global index, i.e. grouped by owner rank.
+// The global system is solved with Jacobi PCG; a matrix-vector product exchanges the ghost
+// values with the neighbouring ranks, dot products are reduced over all ranks. Rank 0 gathers
+// the temperatures and writes the results.
+class DistributedSolver {
+private:
+    MPI_Comm comm;
+    int rank, ranks_count;
+    Grid& global_grid;
+    vector<int> offsets;
+    int owned_count;
+    vector<int32_t> local_to_global;
+    unique_ptr<Grid> local_grid;
+    unique_ptr<FEMSolver> local_solver;
+    SparseMatrix H_local, C_local, A_local;
+    vector<double> P_owned, inv_diagonal;
+    double solver_tolerance;
+    int solver_max_iterations;
+    int last_iterations;
+    string results_directory;
+
+    vector<int> neighbours;
+    vector<vector<int32_t>> send_indices;
+    vector<int> receive_offsets;
+    vector<vector<double>> send_buffers;
+    vector<double> halo_x;
+    vector<double> r, z, p, Ap;
+
+    void build_partition();
+    void build_halo();
+    void exchange_halo(const vector<double>& x_owned);
+    void multiply(const SparseMatrix& A, const vector<double>& x_owned, vector<double>& y_owned);
+    double dot(const vector<double>& a, const vector<double>& b) const;
+    void prepare_solver(const SparseMatrix& A);
+    bool solve(const vector<double>& b, vector<double>& x);
+    void gather(const vector<double>& x_owned, vector<double>& x_global) const;
+
+public:
+    DistributedSolver(Grid& grid, MPI_Comm comm, double alpha, int thread_count);
+    void set_solver(double tolerance, int max_iterations);
+    void set_results_directory(const string& directory);
+    void assemble(double conductivity, double density, double specific_heat, double alpha, double ambient_temperature);
+    // Returns false when the results cannot be opened or a solve fails, on every rank.
+    bool simulate_time(double initial_temperature, double time_step, double total_time, ResultFormat format, const OutputOptions& output);
+    int get_owned_count() const;
+    int get_ghost_count() const;
+};
+
+#endif // FEM_MPI
+
+#endif // DISTRIBUTEDSOLVER_H
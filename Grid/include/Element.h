@@ -2,28 +2,29 @@
 #define ELEMENT_H 
 
 #include <iostream>
-#include <vector>
+#include <cstdint>
 #include "Node.h"
 
-using std::vector;
-
+// Lightweight view of one element inside the structure-of-arrays mesh held by Grid, 4 nodes
+// unless the mesh uses another element type. It does not own any data, so it is cheap to
+// create on the fly inside element loops.
 class Element {
 private:
-    Node nodes_xy[4]; 
-    vector<int> ID;
-    vector<vector<double>> Hbc;
-    vector<double> P;
+    const int32_t* ID;
+    const double* x;
+    const double* y;
+    const int32_t* bc;
+    int nodes_count;
 
 public:
-    Element(const Node& n1, const Node& n2, const Node& n3, const Node& n4);
-    void set_ID(int node_1, int node_2, int node_3, int node_4);
+    Element(const int32_t* ID, const double* x, const double* y, const int32_t* bc, int nodes_count = 4);
+    int get_nodes_count() const;
     void display_ID() const;
-    const Node* get_nodes() const;
-    const vector<int>& get_ID() const;
-    void set_Hbc(const vector<vector<double>>& hbc);
-    const vector<vector<double>>& get_Hbc() const;
-    void set_P(const vector<double>& p);
-    const vector<double>& get_P() const;
+    const int32_t* get_ID() const;
+    double get_x(int local_node) const;
+    double get_y(int local_node) const;
+    int get_BC(int local_node) const;
+    Node get_node(int local_node) const;
 };
 
-#endif // ELEMENT_H
\ No newline at end of file
+#endif // ELEMENT_H
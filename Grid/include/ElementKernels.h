@@ -0,0 +1,42 @@
+#ifndef ELEMENTKERNELS_H
+#define ELEMENTKERNELS_H
+
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+enum class KernelType {
+    Auto,
+    Scalar,
+    AVX2,
+    AVX512
+};
+
+// Quadrature table seen by the batched kernels: points_count points, shape values and
+// derivatives stored flat as p * 4 + i.
+struct ShapeTableView {
+    int points_count;
+    const double* weight;
+    const double* N;
+    const double* dN_dxi;
+    const double* dN_deta;
+};
+
+// Throws invalid_argument for orders without a GaussRule.
+ShapeTableView get_shape_table_view(int order);
+
+// Picks the widest kernel the CPU supports for Auto; an explicitly requested kernel the CPU
+// cannot run falls back to Scalar.
+KernelType resolve_kernel_type(KernelType requested);
+int get_kernel_batch_width(KernelType type);
+string get_kernel_name(KernelType type);
+bool parse_kernel_type(const string& name, KernelType& type);
+
+// Local H (and C when C is not null) for elements first .. first + width - 1, written as 4x4
+// blocks at H + 16 * e. Returns false without touching the batch when an element has a
+// degenerate Jacobian, so the caller can handle it with the scalar path.
+bool compute_element_batch(KernelType type, const ShapeTableView& table, const double* x, const double* y, const int32_t* connectivity,
+                           long first, double conductivity, double density_specific_heat, double* H, double* C);
+
+#endif // ELEMENTKERNELS_H
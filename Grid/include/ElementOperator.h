@@ -0,0 +1,40 @@
+#ifndef ELEMENTOPERATOR_H
+#define ELEMENTOPERATOR_H
+
+#include <cstdint>
+#include <vector>
+#include "Grid.h"
+#include "LinearOperator.h"
+
+using std::vector;
+
+// Matrix-free global operator: y = sum over elements of (sum_k scale_k * B_k,e) * x_e, where
+// B_k holds the cached n x n local blocks of the grid's n-node elements (element e at n^2 * e). Only O(nE) element data is
+// kept, no global matrix is assembled. With several threads the scatter runs one element
+// color at a time so no two threads update the same node.
+class ElementOperator : public LinearOperator {
+private:
+    struct Term {
+        const double* blocks;
+        double scale;
+    };
+
+    const int32_t* connectivity;
+    int elements_count;
+    int nodes_count;
+    int nodes_per_element;
+    int thread_count;
+    const vector<vector<int>>* element_colors;
+    vector<Term> terms;
+
+    void apply_element(int element, const vector<double>& x, vector<double>& y) const;
+
+public:
+    ElementOperator(Grid& grid, int thread_count);
+    void add_term(const vector<double>& blocks, double scale);
+    int size() const override;
+    void apply(const vector<double>& x, vector<double>& y) const override;
+    void get_diagonal(vector<double>& diagonal) const override;
+};
+
+#endif // ELEMENTOPERATOR_H
@@ -0,0 +1,191 @@
+#ifndef ELEMENTTYPES_H
+#define ELEMENTTYPES_H
+
+#include <cstdint>
+#include <string>
+#include "Integration.h"
+
+using std::string;
+
+enum class ElementType : int32_t {
+    Quad4,
+    Quad8,
+    Quad9,
+    Tri3
+};
+
+constexpr int max_element_nodes = 9;
+
+int get_element_nodes_count(ElementType type);
+string get_element_type_name(ElementType type);
+bool parse_element_type(const string& name, ElementType& type);
+
+// Compile-time description of an element: node count, shape functions at a reference point,
+// the quadrature rule used for H and C, and the boundary edges as local node indices (end
+// nodes first, then the mid-edge node of quadratic elements). Quadrilaterals use [-1, 1]^2
+// with corners 0..3 counter-clockwise from (-1, -1), mid-side nodes 4..7 on edges 0-1, 1-2,
+// 2-3, 3-0 and the centre node 8. Triangles use the unit triangle (0,0), (1,0), (0,1).
+template <ElementType Type>
+struct ElementTraits;
+
+namespace element_detail {
+
+constexpr int quad_corner_xi[4] = { -1, 1, 1, -1 };
+constexpr int quad_corner_eta[4] = { -1, -1, 1, 1 };
+constexpr int quad9_xi[9] = { -1, 1, 1, -1, 0, 1, 0, -1, 0 };
+constexpr int quad9_eta[9] = { -1, -1, 1, 1, -1, 0, 1, 0, 0 };
+
+// 1D quadratic Lagrange polynomial on nodes -1, 0, 1 and its derivative.
+constexpr double lagrange(int node, double s) {
+    return node < 0 ? 0.5 * s * (s - 1) : node > 0 ? 0.5 * s * (s + 1) : 1 - s * s;
+}
+
+constexpr double lagrange_derivative(int node, double s) {
+    return node < 0 ? s - 0.5 : node > 0 ? s + 0.5 : -2 * s;
+}
+
+}
+
+template <>
+struct ElementTraits<ElementType::Quad4> {
+    static constexpr int nodes = 4;
+    static constexpr int edges = 4;
+    static constexpr int edge_nodes = 2;
+    static constexpr int edge[4][2] = { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 } };
+    static constexpr int rule_order = 2;
+    static constexpr int points_count = rule_order * rule_order;
+
+    static constexpr void point(int p, double& xi, double& eta, double& weight) {
+        xi = GaussRule<rule_order>::points[p / rule_order];
+        eta = GaussRule<rule_order>::points[p % rule_order];
+        weight = GaussRule<rule_order>::weights[p / rule_order] * GaussRule<rule_order>::weights[p % rule_order];
+    }
+
+    static constexpr void shape(double xi, double eta, double* N, double* dN_dxi, double* dN_deta) {
+        for (int i = 0; i < 4; ++i) {
+            double a = element_detail::quad_corner_xi[i], b = element_detail::quad_corner_eta[i];
+            N[i] = 0.25 * (1 + a * xi) * (1 + b * eta);
+            dN_dxi[i] = 0.25 * a * (1 + b * eta);
+            dN_deta[i] = 0.25 * b * (1 + a * xi);
+        }
+    }
+};
+
+// Serendipity quadratic quadrilateral.
+template <>
+struct ElementTraits<ElementType::Quad8> {
+    static constexpr int nodes = 8;
+    static constexpr int edges = 4;
+    static constexpr int edge_nodes = 3;
+    static constexpr int edge[4][3] = { { 0, 1, 4 }, { 1, 2, 5 }, { 2, 3, 6 }, { 3, 0, 7 } };
+    static constexpr int rule_order = 3;
+    static constexpr int points_count = rule_order * rule_order;
+
+    static constexpr void point(int p, double& xi, double& eta, double& weight) {
+        xi =GaussRule<rule_order>::points[p / rule_order];
+        eta = GaussRule<rule_order>::points[p % rule_order];
+        weight = GaussRule<rule_order>::weights[p / rule_order] * GaussRule<rule_order>::weights[p % rule_order];
+    }
+
+    static constexpr void shape(double xi, double eta, double* N, double* dN_dxi, double* dN_deta) {
+        for (int i = 0; i < 4; ++i) {
+            double a = element_detail::quad_corner_xi[i], b = element_detail::quad_corner_eta[i];
+            N[i] = 0.25 * (1 + a * xi) * (1 + b * eta) * (a * xi + b * eta - 1);
+            dN_dxi[i] = 0.25 * a * (1 + b * eta) * (2 * a * xi + b * eta);
+            dN_deta[i] = 0.25 * b * (1 + a * xi) * (a * xi + 2 * b * eta);
+        }
+        for (int i = 4; i < 8; ++i) {
+            double a = element_detail::quad9_xi[i], b = element_detail::quad9_eta[i];
+            if (a == 0) {
+                N[i] = 0.5 * (1 - xi * xi) * (1 + b * eta);
+                dN_dxi[i] = -xi * (1 + b * eta);
+                dN_deta[i] = 0.5 * b * (1 - xi * xi);
+            } else {
+                N[i] = 0.5 * (1 + a * xi) * (1 - eta * eta);
+                dN_dxi[i] = 0.5 * a * (1 - eta * eta);
+                dN_deta[i] = -eta * (1 + a * xi);
+            }
+        }
+    }
+};
+
+// Lagrange biquadratic quadrilateral.
+template <>
+struct ElementTraits<ElementType::Quad9> {
+    static constexpr int nodes = 9;
+    static constexpr int edges = 4;
+    static constexpr int edge_nodes = 3;
+    static constexpr int edge[4][3] = { { 0, 1, 4 }, { 1, 2, 5 }, { 2, 3, 6 }, { 3, 0, 7 } };
+    static constexpr int rule_order = 3;
+    static constexpr int points_count = rule_order * rule_order;
+
+    static constexpr void point(int p, double& xi, double& eta, double& weight) {
+        xi = GaussRule<rule_order>::points[p / rule_order];
+        eta = GaussRule<rule_order>::points[p % rule_order];
+        weight = GaussRule<rule_order>::weights[p / rule_order] * GaussRule<rule_order>::weights[p % rule_order];
+    }
+
+    static constexpr void shape(double xi, double eta, double* N, double* dN_dxi, double* dN_deta) {
+        using element_detail::lagrange;
+        using element_detail::lagrange_derivative;
+        for (int i = 0; i < 9; ++i) {
+            int a = element_detail::quad9_xi[i], b = element_detail::quad9_eta[i];
+            N[i] = lagrange(a, xi) * lagrange(b, eta);
+            dN_dxi[i] = lagrange_derivative(a, xi) * lagrange(b, eta);
+            dN_deta[i] = lagrange(a, xi) * lagrange_derivative(b, eta);
+        }
+    }
+};
+
+// Linear triangle with the 3-point rule, exact for the quadratic mass integrand.
+template <>
+struct ElementTraits<ElementType::Tri3> {
+    static constexpr int nodes = 3;
+    static constexpr int edges = 3;
+    static constexpr int edge_nodes = 2;
+    static constexpr int edge[3][2] = { { 0, 1 }, { 1, 2 }, { 2, 0 } };
+    static constexpr int points_count = 3;
+
+    static constexpr void point(int p, double& xi, double& eta, double& weight) {
+        xi = p == 1 ? 2.0 / 3.0 : 1.0 / 6.0;
+        eta = p == 2 ? 2.0 / 3.0 : 1.0 / 6.0;
+        weight = 1.0 / 6.0;
+    }
+
+    static constexpr void shape(double xi, double eta, double* N, double* dN_dxi, double* dN_deta) {
+        N[0] = 1 - xi - eta;
+        N[1] = xi;
+        N[2] = eta;
+        dN_dxi[0] = -1;
+        dN_dxi[1] = 1;
+        dN_dxi[2] = 0;
+        dN_deta[0] = -1;
+        dN_deta[1] = 0;
+        dN_deta[2] = 1;
+    }
+};
+
+// Shape functions of an element type tabulated at its quadrature points, like
+// ShapeFunctionTable for the 4-node element.
+template <ElementType Type>
+struct ElementShapeTable {
+    using Traits = ElementTraits<Type>;
+    static constexpr int points_count = Traits::points_count;
+    double weight[points_count];
+    double N[points_count][Traits::nodes];
+    double dN_dxi[points_count][Traits::nodes];
+    double dN_deta[points_count][Traits::nodes];
+
+    constexpr ElementShapeTable() : weight{}, N{}, dN_dxi{}, dN_deta{} {
+        for (int p = 0; p < points_count; ++p) {
+            double xi = 0.0, eta = 0.0;
+            Traits::point(p, xi, eta, weight[p]);
+            Traits::shape(xi, eta, N[p], dN_dxi[p], dN_deta[p]);
+        }
+    }
+};
+
+template <ElementType Type>
+inline constexpr ElementShapeTable<Type> element_shape_table{};
+
+#endif // ELEMENTTYPES_H
@@ -2,33 +2,208 @@
 #define FEMSOLVER_H 
 
 #include <iostream>
+#include <functional>
+#include <memory>
 #include <vector>
 #include "Grid.h"   
 #include "Element.h" 
+#include "SparseMatrix.h"
+#include "LinearSolver.h"
+#include "UniversalElement.h"
+#include "ResultWriter.h"
+#include "ElementKernels.h"
+#include "ElementTypes.h"
+#include "GlobalData.h"
+#include "Checkpoint.h"
+#include "Material.h"
+
+enum class MassMatrix {
+    Consistent,
+    Lumped
+};
+
+enum class TimeScheme {
+    Implicit,
+    Explicit
+};
+
+enum class AssemblyMode {
+    Serial,
+    Colored,
+    ThreadBuffers
+};
+
+// System matrix (C/dt + H) of one time step size together with its factorized solver.
+struct TimeStepSystem {
+    unique_ptr<LinearOperator> A;
+    unique_ptr<LinearSolver> solver;
+};
+
+// One load case of a solver session: material and boundary scalars, initial temperature and
+// fixed implicit time stepping.
+struct SolveRequest {
+    double conductivity;
+    double density_specific_heat;
+    double alpha;
+    double ambient_temperature;
+    double initial_temperature;
+    double time_step;
+    double total_time;
+};
 
 class FEMSolver {
 private:
     Grid& grid;
-    vector<vector<double>> local_H_matrices, local_C_matrices;
+    // Local blocks are nodes_per_element x nodes_per_element, element e at block_size * e.
+    int nodes_per_element, block_size;
+    vector<double> local_H_matrices, local_C_matrices;
+    vector<double> local_Hbc_matrices, local_P_vectors;
     vector<double> P_global;
+    mutable vector<vector<double>> thread_buffers;
+    SolverType solver_type;
+    double solver_tolerance;
+    int solver_max_iterations;
+    int integration_order;
+    int thread_count;
+    AssemblyMode assembly_mode;
+    ResultFormat result_format;
+    OutputOptions output_options;
+    KernelType kernel_type;
+    MassMatrix mass_matrix;
+    bool adaptive_stepping;
+    double step_tolerance;
+    double max_time_step;
+    bool write_intermediate;
+    SparseMatrix K_unit, Hbc_unit, C_unit;
+    vector<double> P_unit;
+    bool unit_operators_cached;
+    string checkpoint_path, restart_path;
+    int checkpoint_interval;
+    double nonlinear_tolerance;
+    int nonlinear_max_iterations;
+    double reassembly_tolerance;
+    string results_directory;
+    SparseMatrix session_H, session_C, session_A;
+    vector<double> session_P;
+    unique_ptr<LinearSolver> session_solver;
+    SolveRequest session_request;
+    int session_factorizations;
+
+    void assemble_matrix(const vector<double>& local_matrices, SparseMatrix& global) const;
+    void assemble_vector(vector<double>& global) const;
+    void reset_thread_buffers(size_t size) const;
+    void compute_local_blocks(double conductivity, double density_specific_heat, bool with_C);
+    unique_ptr<LinearSolver> create_matrix_free_solver() const;
+    void write_t_vector(const vector<double>& t_solver) const;
+    // Returns the temperatures after the last step, empty when the results could not be opened
+    // or a solve failed.
+    vector<double> run_time_steps(LinearSolver& linear_solver, const LinearOperator& C_global, const vector<double>& P_global,
+                                  const vector<double>& t_initial, double time_step, double total_time);
+    bool run_adaptive_steps(const LinearOperator& C_global, const std::function<unique_ptr<TimeStepSystem>(double)>& build_system,
+                            const vector<double>& P_global, const vector<double>& t_initial, double time_step, double total_time);
+    bool run_explicit_steps(const LinearOperator& H_global, const vector<double>& P_global, const vector<double>& t_initial, double time_step, double total_time);
+    static int count_time_steps(double time_step, double total_time);
+    string get_results_path(const string& name) const;
+    bool open_results(ResultWriter& writer, int num_nodes, double time_step, const string& name = "simulation_temperatures") const;
+    bool begin_run(ResultWriter& writer, const vector<double>& t_initial, double time_step, bool fixed_step, CheckpointState& state);
+    void save_checkpoint(ResultWriter& writer, int64_t step, double time, double time_step, double previous_step,
+                         const vector<double>& t_current, const vector<double>& t_previous) const;
+    void write_time_step(ResultWriter& writer, double time, const vector<double>& temperatures) const;
+    void lump_mass_matrices();
+    template <ElementType Type>
+    void integrate_boundary_edges(const Element& element, double alpha, double ambient_temperature, double* Hbc, double* P) const;
+    void integrate_boundary_edges(const Element& element, double alpha, double ambient_temperature, double* Hbc, double* P) const;
+    void compute_unit_blocks(vector<double>& K_blocks, vector<double>& C_blocks);
+    void cache_unit_operators();
 public:
     explicit FEMSolver(Grid& grid, double alpha, double ambient_temperature);
+    void set_solver(SolverType type, double tolerance, int max_iterations);
+    // Returns false, keeping the current order, when there is no Gauss rule of that order.
+    bool set_integration_order(int order);
+    void set_thread_count(int threads);
+    void set_assembly_mode(AssemblyMode mode);
+    void set_result_format(ResultFormat format);
+    void set_output_options(const OutputOptions& options);
+    void set_kernel(KernelType type);
+    KernelType get_kernel() const;
+    void set_mass_matrix(MassMatrix type);
+    // Adaptive implicit stepping: dt starts at time_step and is halved or doubled so that the
+    // estimated local error stays below tolerance (in kelvin); max_step <= 0 means unbounded.
+    void set_adaptive_stepping(bool enabled, double tolerance, double max_step);
+    // Global H, C, P and steady-state t are written to results/ unless this is disabled.
+    void set_write_intermediate(bool enabled);
+    // Transient runs write a checkpoint to path every interval steps (accepted steps when
+    // adaptive). A restart path makes the next transient run continue from that checkpoint,
+    // appending to the results file it was written with; the run itself must be set up with
+    // the same mesh, data and options.
+    void set_checkpoint(const string& path, int interval);
+    void set_restart(const string& path);
+    // Directory of the results and intermediate files, ../Grid/results by default.
+    void set_results_directory(const string& directory);
+    // Nonlinear runs: a step has converged when the largest correction is below tolerance (in
+    // kelvin); an element is re-evaluated once its mean temperature moves by more than
+    // reassembly_tolerance.
+    void set_nonlinear(double tolerance, int max_iterations, double reassembly_tolerance);
     void display_matrix(vector<vector<double>>& matrix);
     void compute_jacobian(const Element& element, double xi, double eta, double J[2][2]) const;
+    void compute_jacobian(const Element& element, const double* dN_dxi, const double* dN_deta, double J[2][2]) const;
     double compute_jacobian_determinant(double J[2][2]) const; 
     void compute_inverse_jacobian(double J[2][2], double invJ[2][2]) const; 
+    void compute_element_matrices(const Element& element, const UniversalElement& universal, double conductivity, double density_specific_heat, double H[16], double* C) const;
+    template <int Order>
+    void compute_element_matrices(const Element& element, double conductivity, double density_specific_heat, double H[16], double* C) const;
+    template <ElementType Type>
+    void compute_element_matrices(const Element& element, double conductivity, double density_specific_heat, double* H, double* C) const;
+    // Element matrices of the grid's element type, nodes_per_element^2 values each.
+    void compute_element_matrices(const Element& element, double conductivity, double density_specific_heat, double* H, double* C) const;
+    void calculate_local_matrices(double conductivity, double density, double specific_heat);
     void calculate_Hbc_matrix(double conductivity);
     double calculate_H_integrand(const Element& element, double conductivity, int i, int j, double xi, double eta) const;
-    void aggregate_Hbc_matrix(vector<vector<double>>& H_global, int nodes_num) const;
+    void aggregate_Hbc_matrix(SparseMatrix& H_global, int nodes_num) const;
     void calculate_local_Hbc_matrix(double alpha);
-    void integrate_Hbc_on_edge(const Node& node1, const Node& node2, double alpha, vector<vector<double>>& Hbc) const;
+    void integrate_Hbc_on_edge(const Node& node1, const Node& node2, double alpha, double Hbc[2][2]) const;
     void compute_edge_jacobian(const Node& node1, const Node& node2, double xi, double& detJ) const;
     void calculate_P_vector(double alpha, double ambient_temperature);
     void aggregate_P_vector(vector<double>& P_global, int nodes_num) const;
-    void solve_system(vector<vector<double>>& H_global, vector<double>& P_global, vector<double>& t_global);
+    // The solve and simulate functions return false when a factorization or a linear solve
+    // fails; transient runs stop at that step, with the frames written so far kept.
+    bool solve_system(const SparseMatrix& H_global, const vector<double>& P_global, vector<double>& t_global);
+    bool solve_system(const vector<double>& P_global, vector<double>& t_global);
     void calculate_C_matrix(double density, double specific_heat);
-    void aggregate_C_matrix(vector<vector<double>>& C_global, int nodes_num) const;
-    void simulate_time(vector<vector<double>>& H_global, vector<vector<double>>& C_global, vector<double>& P_global, vector<double>& t_initial, double time_step, double total_time);
+    void aggregate_C_matrix(SparseMatrix& C_global, int nodes_num) const;
+    bool simulate_time(const SparseMatrix& H_global, const SparseMatrix& C_global, const vector<double>& P_global, vector<double>& t_initial, double time_step, double total_time);
+    // Matrix-free variants: the global H and C are applied element by element from the cached
+    // local matrices, so no global matrix is built. They are solved with PCG.
+    bool simulate_time(const vector<double>& P_global, vector<double>& t_initial, double time_step, double total_time);
+    // Global H, C and P from operators assembled once with unit coefficients: interior
+    // conductance K, boundary convection Hbc, capacity C and the boundary load P, so that
+    // H = k K + alfa Hbc, C = rho c C_unit and P = alfa T_ambient P_unit. Changing the
+    // material or boundary scalars costs O(nnz) instead of a reassembly.
+    void combine_operators(double conductivity, double density_specific_heat, double alpha, double ambient_temperature,
+                           SparseMatrix& H_global, SparseMatrix& C_global, vector<double>& P_global);
+    // Runs K load cases together against one factorization of C/dt + H per distinct alfa:
+    // P scales with the ambient temperature, so each group is a block of right-hand sides.
+    // Temperatures go to results/scenario_<k>_temperatures. The global matrices come from
+    // combine_operators, so the local matrices are left untouched.
+    bool simulate_scenarios(const vector<Scenario>& scenarios, double conductivity, double density, double specific_heat, double time_step, double total_time);
+    // Fixed implicit steps with temperature-dependent k and rho c, evaluated per element at its
+    // mean temperature. Only the elements whose temperature changed are updated in the global
+    // H and C, and the factorization is reused across iterations and steps while it still
+    // converges fast, so most iterations cost a residual and a solve.
+    bool simulate_time_nonlinear(const Material& material, const vector<double>& P_global, vector<double>& t_initial, double time_step,
+                                 double total_time);
+    // Session entry point for repeated solves on this mesh: fixed implicit steps with the global
+    // operators from combine_operators. The factorization of C/dt + H is kept while the
+    // conductivity, rho c, alfa and time step of the requests stay the same, so a request that
+    // only changes the ambient or initial temperature or the end time costs its time steps alone.
+    // Temperatures go to results/simulation_temperatures; t_final is in the original node order.
+    bool solve(const SolveRequest& request, vector<double>& t_final);
+    int get_session_factorizations() const;
+    double compute_stable_time_step(vector<double>& lumped_mass) const;
+    // Forward Euler with the lumped C: one H product per step and no solve. Time steps above
+    // the stability limit are split into equal substeps.
+    bool simulate_time_explicit(const SparseMatrix& H_global, const vector<double>& P_global, vector<double>& t_initial, double time_step, double total_time);
+    bool simulate_time_explicit(const vector<double>& P_global, vector<double>& t_initial, double time_step, double total_time);
 };
 
 #endif // FEMSOLVER_H
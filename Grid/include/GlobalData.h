@@ -2,22 +2,29 @@
 #define GLOBALDATA_H
 
 #include <iostream>
-#include "Node.h"
-#include "Element.h"
 #include <fstream>
+#include <string>
 #include <vector>
+#include "Material.h"
 
-using std::vector;
 using std::string;
+using std::vector;
+
+// One load case of a parameter sweep over the same mesh and material.
+struct Scenario {
+    double alfa;
+    double ambient_temp;
+    double initial_temp;
+};
 
 class GlobalData {
 private:
     double simulation_time, simulation_step_time, conductivity, alfa, ambient_temp, initial_temp, density, specific_heat, nN, nE, nH, nW, H, W;
-    vector<Element> elements;
-    static vector<Node> nodes_xy;
 
 public:
-    void read_file();
+    // The values are replaced only when the whole file is valid, so a failed read keeps the
+    // previous data.
+    bool read_file(const string& data_directory = "../Grid/data");
     double get_simulation_time();
     double get_simulation_step_time();
     double get_conductivity();
@@ -32,8 +39,12 @@ public:
     double get_nW();
     double get_height();
     double get_width();
-    const static vector<Node>& get_nodes();
     void display_simulation_data();
+    static bool read_scenarios(const string& path, vector<Scenario>& scenarios);
+    // Temperature tables, one "conductivity|density|specific_heat <temperature> <value>" point
+    // per line with increasing temperatures, at least two per listed property; properties without
+    // points keep their value.
+    static bool read_material(const string& path, Material& material);
 };
 
 #endif // GLOBALDATA_H
\ No newline at end of file
@@ -1,26 +1,91 @@
 #ifndef GRID_H
 #define GRID_H
 
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 #include "Node.h"
 #include "Element.h"
-#include "GlobalData.h"
+#include "ElementTypes.h"
+#include "MeshLoader.h"
 
 using std::vector;
+using std::string;
+using std::shared_ptr;
 
+enum class MeshSource {
+    File,
+    Generated
+};
+
+// Mesh stored as structure of arrays: node coordinates and boundary flags in contiguous
+// arrays, element connectivity as a flat array with get_nodes_per_element() node indices per
+// element, 4 for the default bilinear quadrilaterals. Nodes are numbered row by row, nW nodes
+// per row and nH rows, either as read from xy_nodes.txt or generated directly from nW, nH, H
+// and W. Generated quadratic quadrilaterals keep the (nW - 1) x (nH - 1) elements and add the
+// mid-side (and, for Quad9, centre) nodes on a (2 nW - 1) x (2 nH - 1) lattice; triangles
+// split every cell in two. A binary mesh file also carries its own element type and
+// connectivity and is used in place through a memory mapping instead of being copied.
 class Grid {
 private:
     double nN, nE, nW, nH, height, width;
-    vector<Node> nodes;
-    static vector<Node> nodes_xy;
-    vector<Element> elements;
+    vector<double> x_storage, y_storage;
+    vector<int32_t> bc_storage, connectivity_storage;
+    shared_ptr<MappedFile> mapped_mesh;
+    const double* x;
+    const double* y;
+    const int32_t* bc;
+    const int32_t* connectivity;
+    int nodes_count, elements_count;
+    ElementType element_type;
+    int nodes_per_element;
+    vector<vector<int>> element_colors;
+    vector<int32_t> node_permutation;
+
+    void bind_storage();
+    void take_ownership();
+    void set_element_type(ElementType type);
+    void generate_quadratic_nodes();
+    void create_quadratic_elements();
+    void create_triangles();
 
 public:
     Grid();
-    Grid(double p_nN, double p_nE, double p_nW, double p_nH, double p_height, double p_width);
-    vector<Element>& get_elements();
+    Grid(double p_nN, double p_nE, double p_nW, double p_nH, double p_height, double p_width, MeshSource source = MeshSource::File,
+         const string& mesh_path = "../Grid/data/xy_nodes.txt", ElementType type = ElementType::Quad4);
+    // Mesh built from given node arrays and connectivity, e.g. one rank's part of a larger mesh.
+    Grid(vector<double> p_x, vector<double> p_y, vector<int32_t> p_bc, vector<int32_t> p_connectivity,
+         ElementType type = ElementType::Quad4);
+    Grid(const Grid&) = delete;
+    Grid& operator=(const Grid&) = delete;
+    bool load_text_nodes(const string& path);
+    bool load_binary_mesh(const string& path);
+    bool write_binary_mesh(const string& path) const;
+    void generate_nodes();
     void create_elements();
+    int get_nodes_count() const;
+    int get_elements_count() const;
+    ElementType get_element_type() const;
+    int get_nodes_per_element() const;
+    Element get_element(int element) const;
+    const int32_t* get_element_nodes(int element) const;
+    const double* get_x() const;
+    const double* get_y() const;
+    const int32_t* get_bc() const;
+    const int32_t* get_connectivity() const;
+    // Reverse Cuthill-McKee renumbering of the nodes to reduce the bandwidth and fill-in of
+    // the global matrices; coordinates, boundary flags and connectivity are permuted, a
+    // mapped binary mesh is copied first. Must run before the solver is set up.
+    void reorder_nodes();
+    int get_bandwidth() const;
+    // New index of each node of the input numbering, or nullptr when nodes were not reordered.
+    const int32_t* get_node_permutation() const;
+    void to_original_order(const vector<double>& values, vector<double>& original) const;
+    void from_original_order(const vector<double>& original, vector<double>& values) const;
+    void color_elements();
+    const vector<vector<int>>& get_element_colors();
     void display_grid_data();
 };
 
-#endif // GRID_H
\ No newline at end of file
+#endif // GRID_H
@@ -8,24 +8,133 @@
 using std::function;
 using std::vector;
 
+// Gauss-Legendre quadrature on [-1, 1], known at compile time so that loops over a rule
+// can be fully unrolled by the compiler.
+template <int N>
+struct GaussRule;
+
+template <>
+struct GaussRule<2> {
+    static constexpr int order = 2;
+    static constexpr double points[2] = {
+        -0.577350269189625764509148780502,
+         0.577350269189625764509148780502
+    };
+    static constexpr double weights[2] = {
+         1.000000000000000000000000000000,
+         1.000000000000000000000000000000
+    };
+};
+
+template <>
+struct GaussRule<3> {
+    static constexpr int order = 3;
+    static constexpr double points[3] = {
+        -0.774596669241483377035853079956,
+         0.0,
+         0.774596669241483377035853079956
+    };
+    static constexpr double weights[3] = {
+         0.555555555555555555555555555556,
+         0.888888888888888888888888888889,
+         0.555555555555555555555555555556
+    };
+};
+
+template <>
+struct GaussRule<4> {
+    static constexpr int order = 4;
+    static constexpr double points[4] = {
+        -0.861136311594052575223946488893,
+        -0.339981043584856264802665759103,
+         0.339981043584856264802665759103,
+         0.861136311594052575223946488893
+    };
+    static constexpr double weights[4] = {
+         0.347854845137453857373063949222,
+         0.652145154862546142626936050778,
+         0.652145154862546142626936050778,
+         0.347854845137453857373063949222
+    };
+};
+
+template <>
+struct GaussRule<9> {
+    static constexpr int order = 9;
+    static constexpr double points[9] = {
+        -0.968160239507626089835576202904,
+        -0.836031107326635794299429788070,
+        -0.613371432700590397308702039341,
+        -0.324253423403808929038538014643,
+         0.0,
+         0.324253423403808929038538014643,
+         0.613371432700590397308702039341,
+         0.836031107326635794299429788070,
+         0.968160239507626089835576202904
+    };
+    static constexpr double weights[9] = {
+         0.081274388361574411971892158111,
+         0.180648160694857404058472031243,
+         0.260610696402935462318742869419,
+         0.312347077040002840068630406584,
+         0.330239355001259763164525069287,
+         0.312347077040002840068630406584,
+         0.260610696402935462318742869419,
+         0.180648160694857404058472031243,
+         0.081274388361574411971892158111
+    };
+};
+
+template <>
+struct GaussRule<16> {
+    static constexpr int order = 16;
+    static constexpr double points[16] = {
+        -0.989400934991649932596154173450,
+        -0.944575023073232576077988415535,
+        -0.865631202387831743880467897712,
+        -0.755404408355003033895101194847,
+        -0.617876244402643748446671764049,
+        -0.458016777657227386342419442984,
+        -0.281603550779258913230460501460,
+        -0.095012509837637440185319335425,
+         0.095012509837637440185319335425,
+         0.281603550779258913230460501460,
+         0.458016777657227386342419442984,
+         0.617876244402643748446671764049,
+         0.755404408355003033895101194847,
+         0.865631202387831743880467897712,
+         0.944575023073232576077988415535,
+         0.989400934991649932596154173450
+    };
+    static constexpr double weights[16] = {
+         0.027152459411754094851780572456,
+         0.062253523938647892862843836994,
+         0.095158511682492784809925107602,
+         0.124628971255533872052476282192,
+         0.149595988816576732081501730547,
+         0.169156519395002538189312079030,
+         0.182603415044923588866763667969,
+         0.189450610455068496285396723208,
+         0.189450610455068496285396723208,
+         0.182603415044923588866763667969,
+         0.169156519395002538189312079030,
+         0.149595988816576732081501730547,
+         0.124628971255533872052476282192,
+         0.095158511682492784809925107602,
+         0.062253523938647892862843836994,
+         0.027152459411754094851780572456
+    };
+};
+
 class Integration {
-private:
-    static const double x2[2];
-    static const double w2[2];
-    static const double x3[3];
-    static const double w3[3];
-    static const double x4[4];
-    static const double w4[4];
-    static const double x9[9];
-    static const double w9[9];
-    static const double x16[16];
-    static const double w16[16];
 public:
     Integration();
     double gauss_integration_2D(function<double(double, double)> f, int n, double a, double b, double c, double d); // funkcja | liczba punktów | granice całkowania
     void display_results(double result);
     vector<double> get_weights(int order);
     vector<double> get_points(int order);
+    // Orders with a Gauss rule: 2, 3, 4, 9 and 16.
+    static bool is_supported_order(int order);
 };
 
 #endif // INTEGRATION_H
\ No newline at end of file
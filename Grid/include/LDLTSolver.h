@@ -0,0 +1,35 @@
+#ifndef LDLTSOLVER_H
+#define LDLTSOLVER_H
+
+#include <vector>
+#include "LinearSolver.h"
+#include "SparseMatrix.h"
+
+using std::vector;
+
+// Sparse LDL^T factorization of a symmetric matrix (up-looking, elimination tree based).
+// The symbolic analysis is kept as long as the sparsity pattern does not change, so the
+// same object can be refactorized cheaply and then reused for many solves.
+class LDLTSolver : public LinearSolver {
+private:
+    int n;
+    vector<int> pattern_row_ptr, pattern_col_idx;
+    vector<int> parent, L_col_ptr, L_row_idx;
+    vector<double> L_values, D;
+    bool factorized;
+
+    void analyze(const SparseMatrix& A);
+
+public:
+    LDLTSolver();
+    using LinearSolver::factorize;
+    bool factorize(const SparseMatrix& A) override;
+    bool solve(const vector<double>& b, vector<double>& x) override;
+    bool solve_block(const vector<double>& B, vector<double>& X, int rhs_count) override;
+    string name() const override;
+    bool is_factorized() const;
+    int size() const;
+    int factor_nnz() const;
+};
+
+#endif // LDLTSOLVER_H
@@ -0,0 +1,18 @@
+#ifndef LINEAROPERATOR_H
+#define LINEAROPERATOR_H
+
+#include <vector>
+
+using std::vector;
+
+// Square linear operator y = A * x. Iterative solvers only need the product and the
+// diagonal, so A may be an assembled matrix or applied element by element.
+class LinearOperator {
+public:
+    virtual ~LinearOperator() = default;
+    virtual int size() const = 0;
+    virtual void apply(const vector<double>& x, vector<double>& y) const = 0;
+    virtual void get_diagonal(vector<double>& diagonal) const = 0;
+};
+
+#endif // LINEAROPERATOR_H
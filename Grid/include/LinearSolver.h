@@ -0,0 +1,41 @@
+#ifndef LINEARSOLVER_H
+#define LINEARSOLVER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "SparseMatrix.h"
+#include "LinearOperator.h"
+
+using std::vector;
+using std::string;
+using std::unique_ptr;
+
+enum class SolverType {
+    LDLT,
+    PCG_Jacobi,
+    PCG_IC0,
+    Banded
+};
+
+// Common interface of the linear solver backends. factorize() prepares the solver for a
+// given matrix (factorization or preconditioner setup), solve() may be called many times
+// afterwards. Iterative solvers use the incoming x as the initial guess. Solvers that can
+// work without an assembled matrix also accept a LinearOperator. solve_block() solves for
+// rhs_count right-hand sides at once, stored node-major: B[i * rhs_count + k].
+// get_last_iterations() is 0 for direct solvers.
+class LinearSolver {
+public:
+    virtual ~LinearSolver() = default;
+    virtual bool factorize(const SparseMatrix& A) = 0;
+    virtual bool factorize(const LinearOperator& A);
+    virtual bool solve(const vector<double>& b, vector<double>& x) = 0;
+    virtual bool solve_block(const vector<double>& B, vector<double>& X, int rhs_count);
+    virtual string name() const = 0;
+    virtual int get_last_iterations() const;
+};
+
+unique_ptr<LinearSolver> create_linear_solver(SolverType type, double tolerance = 1e-10, int max_iterations = 1000);
+bool parse_solver_type(const string& text, SolverType& type);
+
+#endif // LINEARSOLVER_H
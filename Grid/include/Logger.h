@@ -0,0 +1,23 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+enum class LogLevel {
+    Quiet = 0,
+    Info = 1,
+    Debug = 2
+};
+
+// Console verbosity. Callers check enabled() before formatting anything, so disabled
+// dumps cost a single comparison. Per-element and per-step dumps are Debug, which is
+// off by default in release (NDEBUG) builds.
+class Logger {
+private:
+    static LogLevel level;
+
+public:
+    static void set_level(LogLevel level);
+    static LogLevel get_level();
+    static bool enabled(LogLevel message_level);
+};
+
+#endif // LOGGER_H
@@ -0,0 +1,34 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <functional>
+#include <vector>
+
+using std::vector;
+using std::function;
+
+// Temperature-dependent material property: a constant, a piecewise-linear table of
+// (temperature, value) points held constant beyond its first and last point, or a callback.
+class MaterialProperty {
+private:
+    double constant;
+    vector<double> temperatures, values;
+    function<double(double)> callback;
+
+public:
+    MaterialProperty(double value = 0.0);
+    // Temperatures must be strictly increasing.
+    static MaterialProperty from_table(vector<double> temperatures, vector<double> values);
+    static MaterialProperty from_function(function<double(double)> callback);
+    bool is_constant() const;
+    double evaluate(double temperature) const;
+};
+
+struct Material {
+    MaterialProperty conductivity, density, specific_heat;
+
+    bool is_constant() const;
+    double get_capacity(double temperature) const;
+};
+
+#endif // MATERIAL_H
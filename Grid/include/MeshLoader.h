@@ -0,0 +1,59 @@
+#ifndef MESHLOADER_H
+#define MESHLOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ElementTypes.h"
+
+using std::vector;
+using std::string;
+using std::shared_ptr;
+
+// Read-only memory mapping of a whole file.
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    bool open(const string& path);
+    void close();
+    const char* get_data() const;
+    size_t size() const;
+};
+
+// Binary mesh layout (native little-endian): "FEMMESH1", int64 nodes count, int64 elements
+// count, then x[nodes], y[nodes] as double, bc[nodes] and connectivity[4 * elements] as int32.
+// Meshes of other element types start with "FEMMESH2" and add an int32 element type and an
+// int32 padding word after the counts; connectivity then holds the element's nodes count per
+// element. All sections stay 8-byte aligned up to bc, so a mapped file is used in place.
+struct BinaryMeshView {
+    int64_t nodes_count;
+    int64_t elements_count;
+    ElementType element_type;
+    const double* x;
+    const double* y;
+    const int32_t* bc;
+    const int32_t* connectivity;
+};
+
+class MeshLoader {
+public:
+    static bool is_binary_mesh(const string& path);
+    static bool load_text_nodes(const string& path, size_t expected_nodes, vector<double>& x, vector<double>& y, vector<int32_t>& bc);
+    static shared_ptr<MappedFile> map_binary_mesh(const string& path, BinaryMeshView& view);
+    static bool write_binary_mesh(const string& path, const BinaryMeshView& view);
+};
+
+#endif // MESHLOADER_H
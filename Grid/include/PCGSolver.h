@@ -0,0 +1,47 @@
+#ifndef PCGSOLVER_H
+#define PCGSOLVER_H
+
+#include <vector>
+#include "LinearSolver.h"
+#include "SparseMatrix.h"
+
+using std::vector;
+
+enum class Preconditioner {
+    Jacobi,
+    IC0
+};
+
+// Preconditioned Conjugate Gradient for the symmetric positive definite global system.
+// The operator passed to factorize() is referenced, not copied, and must outlive the solves.
+// IC(0) needs the assembled matrix; a matrix-free operator is preconditioned with Jacobi. The
+// Jacobi fallback of a matrix-free operator or an IC(0) breakdown applies to that factorization
+// only, the next factorize() tries the requested preconditioner again.
+class PCGSolver : public LinearSolver {
+private:
+    const LinearOperator* A;
+    const SparseMatrix* matrix;
+    Preconditioner preconditioner, active_preconditioner;
+    double tolerance;
+    int max_iterations;
+    int last_iterations;
+    double last_residual;
+    vector<double> inv_diagonal;
+    vector<int> L_row_ptr, L_col_idx;
+    vector<double> L_values;
+    vector<double> r, z, p, Ap;
+
+    bool build_ic0();
+    void apply_preconditioner(const vector<double>& r, vector<double>& z) const;
+
+public:
+    PCGSolver(Preconditioner preconditioner, double tolerance, int max_iterations);
+    bool factorize(const SparseMatrix& A) override;
+    bool factorize(const LinearOperator& A) override;
+    bool solve(const vector<double>& b, vector<double>& x) override;
+    string name() const override;
+    int get_last_iterations() const override;
+    double get_last_residual() const;
+};
+
+#endif // PCGSOLVER_H
@@ -0,0 +1,63 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+using std::map;
+
+// Per-phase wall time and counters (flops, nnz, solver iterations). Phases are recorded from
+// serial code only, around whole loops, so the cost is a clock read per phase. Without
+// FEM_PROFILING the PROFILE_* macros expand to nothing and no instrumentation is compiled in.
+struct PhaseStats {
+    string name;
+    long calls;
+    double seconds;
+    map<string, double> counters;
+};
+
+class Profiler {
+private:
+    static std::mutex stats_mutex;
+    static vector<PhaseStats> phases;
+
+    static PhaseStats& find_phase(const string& name);
+
+public:
+    static void record(const string& phase, double seconds);
+    static void add_counter(const string& phase, const string& counter, double value);
+    static void reset();
+    static vector<PhaseStats> get_phases();
+    static bool write_json(const string& path);
+    static bool write_csv(const string& path);
+    static bool write(const string& path);
+};
+
+class ScopedTimer {
+private:
+    const char* phase;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    explicit ScopedTimer(const char* phase);
+    ~ScopedTimer();
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#ifdef FEM_PROFILING
+#define FEM_PROFILE_CONCAT_INNER(a, b) a##b
+#define FEM_PROFILE_CONCAT(a, b) FEM_PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(phase) ScopedTimer FEM_PROFILE_CONCAT(profile_timer_, __LINE__)(phase)
+#define PROFILE_COUNTER(phase, counter, value) Profiler::add_counter(phase, counter, value)
+#else
+#define PROFILE_SCOPE(phase) ((void)0)
+#define PROFILE_COUNTER(phase, counter, value) ((void)0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,118 @@
+#ifndef RESULTWRITER_H
+#define RESULTWRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::vector;
+using std::string;
+using std::ofstream;
+
+enum class ResultFormat {
+    Text,
+    Binary
+};
+
+enum class FrameEncoding {
+    Double,
+    Float,
+    Delta
+};
+
+// What goes into a results file. A step is written every every_steps steps, or, when
+// every_time is set, at the first step past each multiple of every_time. probes lists node
+// IDs of the input numbering to write instead of the whole field; with fields off only the
+// minimum, maximum and mean of each written step are stored. encoding applies to binary files.
+struct OutputOptions {
+    int every_steps = 1;
+    double every_time = 0.0;
+    vector<int32_t> probes;
+    bool fields = true;
+    FrameEncoding encoding = FrameEncoding::Double;
+    double delta_resolution = 1e-5;
+};
+
+struct FieldStats {
+    double min, max, mean;
+};
+
+// Minimum, maximum and mean in a single pass.
+FieldStats compute_field_stats(const vector<double>& values);
+
+// Writes the temperature field of each time step on a background thread. The solver copies
+// a frame into the pending buffer and continues; the writer thread swaps it with its own
+// buffer and does the disk I/O, so at most one frame is queued behind the one being written.
+//
+// Binary layout (little-endian, mmap friendly) of full double fields:
+//   header: char magic[8] = "FEMTEMP1", int64 nodes, double time_step, int64 steps
+//   frames: double time, double temperatures[nodes]
+// Any other output options use version 2:
+//   header: char magic[8] = "FEMTEMP2", int64 values, double time_step, int64 steps,
+//           int32 encoding (0 double, 1 float, 2 delta, 3 min/max/mean only), int32 probes,
+//           double delta_resolution, int32 probe_ids[probes]
+//   frames: double time, then double values[values], float values[values], the delta block
+//           or double min, max, mean. values is the probe count, or nodes without probes.
+// A delta block is int32 key, int32 bytes and a byte stream of zigzag LEB128 varints: the
+// temperatures are rounded to multiples of delta_resolution and each stored integer is the
+// difference to the previous frame, or to zero for a key frame (every 100th frame and the
+// first one after a restart). The step count is written when the file is closed.
+class ResultWriter {
+private:
+    ofstream file;
+    ResultFormat format;
+    OutputOptions options;
+    int64_t nodes_count, values_count;
+    int64_t steps_written;
+    int64_t steps_offered;
+    double last_offered_time;
+    const int32_t* node_order;
+    double pending_time, writing_time;
+    FieldStats pending_stats, writing_stats;
+    vector<double> pending_frame, writing_frame;
+    vector<int64_t> previous_quantized;
+    vector<uint8_t> encoded;
+    int64_t frames_since_key;
+    bool has_pending, writing, stopping;
+    std::mutex buffer_mutex;
+    std::condition_variable buffer_ready, buffer_free;
+    std::thread writer_thread;
+
+    void run();
+    void write_frame_to_disk();
+    void write_delta_frame();
+    void store_frame(double time, const vector<double>& temperatures, const FieldStats* stats);
+    bool start(int nodes);
+    bool uses_header_v2() const;
+
+public:
+    ResultWriter();
+    ~ResultWriter();
+    // Options apply to the files opened or resumed afterwards.
+    void set_options(const OutputOptions& options);
+    bool open(const string& path, ResultFormat format, int nodes, double time_step);
+    // With a node order set, value i of a written frame is temperatures[order[i]], which maps a
+    // renumbered solution back to the input numbering. The array must outlive the writer.
+    void set_node_order(const int32_t* order);
+    // Reopens a results file written up to a checkpoint: the file is cut back to offset, which
+    // drops frames written after the checkpoint, and frames are appended from there.
+    bool resume(const string& path, ResultFormat format, int nodes, int64_t offset, int64_t frames_written);
+    // Waits until every queued frame is on disk and returns the file size, for a checkpoint.
+    int64_t flush();
+    int64_t get_frames_written() const;  // exact after flush()
+    // Continues the output schedule of a restarted run: steps taken and time reached so far.
+    void restore_schedule(int64_t steps, double time);
+    // Whether the next write_frame for this time is stored, e.g. to skip a device copy.
+    bool is_frame_due(double time) const;
+    // Every step is passed here; steps the output options skip are only counted. The second form
+    // takes the statistics of temperatures from a caller that has computed them already.
+    void write_frame(double time, const vector<double>& temperatures);
+    void write_frame(double time, const vector<double>& temperatures, const FieldStats& stats);
+    void close();
+};
+
+#endif // RESULTWRITER_H
@@ -0,0 +1,48 @@
+#ifndef SPARSEMATRIX_H
+#define SPARSEMATRIX_H
+
+#include <iostream>
+#include <fstream>
+#include <cstdint>
+#include <vector>
+#include "LinearOperator.h"
+
+using std::vector;
+using std::ostream;
+
+// Global matrix in compressed sparse row format. The sparsity pattern comes from element
+// connectivity (nodes_per_element indices per element) and is built once, so assembly only
+// touches existing entries.
+class SparseMatrix : public LinearOperator {
+private:
+    int n;
+    vector<int> row_ptr;
+    vector<int> col_idx;
+    vector<double> values;
+
+public:
+    SparseMatrix();
+    void build_pattern(const int32_t* connectivity, int elements_count, int nodes_per_element, int nodes_num);
+    bool same_pattern(const SparseMatrix& other) const;
+    int find(int row, int col) const;
+    void add(int row, int col, double value);
+    double get(int row, int col) const;
+    void set_zero();
+    void scale(double factor);
+    void add_scaled(const SparseMatrix& other, double factor);
+    void multiply(const vector<double>& x, vector<double>& y) const;
+    void multiply_block(const vector<double>& X, vector<double>& Y, int rhs_count) const;
+    void apply(const vector<double>& x, vector<double>& y) const override;
+    void get_diagonal(vector<double>& diagonal) const override;
+    int size() const override;
+    int nnz() const;
+    const vector<int>& get_row_ptr() const;
+    const vector<int>& get_col_idx() const;
+    const vector<double>& get_values() const;
+    vector<double>& get_values();
+    vector<vector<double>> to_dense() const;
+    void write(ostream& out) const;
+    void display() const;
+};
+
+#endif // SPARSEMATRIX_H
@@ -0,0 +1,69 @@
+#ifndef UNIVERSALELEMENT_H
+#define UNIVERSALELEMENT_H
+
+#include <vector>
+#include "Integration.h"
+
+using std::vector;
+
+// Compile-time counterpart of UniversalElement for the rules in GaussRule<Order>.
+template <int Order>
+struct ShapeFunctionTable {
+    static constexpr int points_count = Order * Order;
+    double weight[points_count];
+    double N[points_count][4];
+    double dN_dxi[points_count][4];
+    double dN_deta[points_count][4];
+
+    constexpr ShapeFunctionTable() : weight{}, N{}, dN_dxi{}, dN_deta{} {
+        for (int i = 0; i < Order; ++i) {
+            for (int j = 0; j < Order; ++j) {
+                int p = i * Order + j;
+                double xi = GaussRule<Order>::points[i];
+                double eta = GaussRule<Order>::points[j];
+                weight[p] = GaussRule<Order>::weights[i] * GaussRule<Order>::weights[j];
+
+                N[p][0] = 0.25 * (1 - xi) * (1 - eta);
+                N[p][1] = 0.25 * (1 + xi) * (1 - eta);
+                N[p][2] = 0.25 * (1 + xi) * (1 + eta);
+                N[p][3] = 0.25 * (1 - xi) * (1 + eta);
+
+                dN_dxi[p][0] = -0.25 * (1 - eta);
+                dN_dxi[p][1] =  0.25 * (1 - eta);
+                dN_dxi[p][2] =  0.25 * (1 + eta);
+                dN_dxi[p][3] = -0.25 * (1 + eta);
+
+                dN_deta[p][0] = -0.25 * (1 - xi);
+                dN_deta[p][1] = -0.25 * (1 + xi);
+                dN_deta[p][2] =  0.25 * (1 + xi);
+                dN_deta[p][3] =  0.25 * (1 - xi);
+            }
+        }
+    }
+};
+
+template <int Order>
+inline constexpr ShapeFunctionTable<Order> shape_function_table{};
+
+// Shape functions of the 4-node bilinear element and their derivatives, tabulated once
+// at the order x order Gauss points. Values are stored point by point: N[p * 4 + i].
+class UniversalElement {
+private:
+    int order;
+    vector<double> weights;
+    vector<double> N, dN_dxi, dN_deta;
+
+public:
+    // Throws invalid_argument for orders without a Gauss rule.
+    explicit UniversalElement(int order);
+    static const UniversalElement& get(int order);
+    int get_order() const;
+    int get_points_count() const;
+    double get_weight(int point) const;
+    const double* get_weights() const;
+    const double* get_N(int point) const;
+    const double* get_dN_dxi(int point) const;
+    const double* get_dN_deta(int point) const;
+};
+
+#endif // UNIVERSALELEMENT_H
@@ -0,0 +1,114 @@
+#include "BandedCholeskySolver.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::max;
+using std::sqrt;
+
+namespace {
+
+// Larger bands are almost always an unordered mesh, where LDLT or RCM renumbering is the answer.
+const size_t max_band_entries = size_t(1) << 28;
+
+}
+
+BandedCholeskySolver::BandedCholeskySolver() : n(0), bandwidth(0), factorized(false) {}
+
+double& BandedCholeskySolver::at(int i, int j) {
+    return band[static_cast<size_t>(i) * (bandwidth + 1) + (j - i + bandwidth)];
+}
+
+double BandedCholeskySolver::at(int i, int j) const {
+    return band[static_cast<size_t>(i) * (bandwidth + 1) + (j - i + bandwidth)];
+}
+
+bool BandedCholeskySolver::factorize(const SparseMatrix& A) {
+    factorized = false;
+    n = A.size();
+    const auto& row_ptr = A.get_row_ptr();
+    const auto& col_idx = A.get_col_idx();
+    const auto& values = A.get_values();
+
+    bandwidth = 0;
+    for (int row = 0; row < n; ++row) {
+        for (int k = row_ptr[row]; k < row_ptr[row + 1]; ++k) {
+            bandwidth = max(bandwidth, row - col_idx[k]);
+        }
+    }
+    if (static_cast<size_t>(n) * (bandwidth + 1) > max_band_entries) {
+        cerr << "Error: bandwidth " << bandwidth << " is too large for the banded solver, use --reorder rcm or the ldlt solver." << endl;
+        return false;
+    }
+
+    band.assign(static_cast<size_t>(n) * (bandwidth + 1), 0.0);
+    for (int row = 0; row < n; ++row) {
+        for (int k = row_ptr[row]; k < row_ptr[row + 1]; ++k) {
+            if (col_idx[k] <= row) {
+                at(row, col_idx[k]) = values[k];
+            }
+        }
+    }
+
+    // Row by row: L(i, j) = (A(i, j) - sum_k L(i, k) L(j, k)) / L(j, j), both rows contiguous in k.
+    for (int i = 0; i < n; ++i) {
+        int first = max(0, i - bandwidth);
+        double* L_i = &at(i, first);
+        for (int j = first; j <= i; ++j) {
+            int k_first = max(first, j - bandwidth);
+            const double* L_ik = L_i + (k_first - first);
+            const double* L_jk = &at(j, k_first);
+            double sum = at(i, j);
+            for (int k = 0; k < j - k_first; ++k) {
+                sum -= L_ik[k] * L_jk[k];
+            }
+
+            if (j < i) {
+                at(i, j) = sum / at(j, j);
+            } else if (sum <= 1e-12) {
+                cerr << "The matrix is not positive definite, the system cannot be solved (pivot " << i << ")." << endl;
+                return false;
+            } else {
+                at(i, i) = sqrt(sum);
+            }
+        }
+    }
+
+    factorized = true;
+    return true;
+}
+
+bool BandedCholeskySolver::solve(const vector<double>& b, vector<double>& x) {
+    if (!factorized) {
+        cerr << "Error: banded Cholesky solve called before a successful factorization." << endl;
+        return false;
+    }
+
+    x = b;
+    for (int i = 0; i < n; ++i) {
+        int first = max(0, i - bandwidth);
+        const double* L_i = &at(i, first);
+        double sum = x[i];
+        for (int k = first; k < i; ++k) {
+            sum -= L_i[k - first] * x[k];
+        }
+        x[i] = sum / at(i, i);
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        int first = max(0, i - bandwidth);
+        const double* L_i = &at(i, first);
+        x[i] /= at(i, i);
+        for (int k = first; k < i; ++k) {
+            x[k] -= L_i[k - first] * x[i];
+        }
+    }
+    return true;
+}
+
+string BandedCholeskySolver::name() const { return "banded Cholesky"; }
+
+int BandedCholeskySolver::get_bandwidth() const { return bandwidth; }
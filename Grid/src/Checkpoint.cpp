@@ -0,0 +1,100 @@
+#include "Checkpoint.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+using std::ifstream;
+using std::ofstream;
+using std::ios;
+using std::memcmp;
+
+namespace {
+
+const char checkpoint_magic[8] = { 'F', 'E', 'M', 'C', 'H', 'K', 'P', '1' };
+
+template <typename T>
+void write_value(ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_value(ifstream& file, T& value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+}
+
+bool Checkpoint::write(const string& path, const CheckpointState& state) {
+    string temporary_path = path + ".tmp";
+    {
+        ofstream file(temporary_path, ios::binary | ios::trunc);
+        if (!file.is_open()) {
+            cerr << "Error: Cannot open " << temporary_path << " for writing." << endl;
+            return false;
+        }
+
+        int64_t nodes = state.t_current.size();
+        file.write(checkpoint_magic, sizeof(checkpoint_magic));
+        write_value(file, nodes);
+        write_value(file, state.step);
+        write_value(file, state.time);
+        write_value(file, state.time_step);
+        write_value(file, state.previous_step);
+        write_value(file, state.results_offset);
+        write_value(file, state.frames_written);
+        file.write(reinterpret_cast<const char*>(state.t_current.data()), nodes * sizeof(double));
+        file.write(reinterpret_cast<const char*>(state.t_previous.data()), nodes * sizeof(double));
+        file.flush();
+        if (!file) {
+            cerr << "Error: Failed to write " << temporary_path << endl;
+            return false;
+        }
+    }
+
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::remove(path.c_str());
+        if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+            cerr << "Error: Cannot replace checkpoint " << path << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Checkpoint::read(const string& path, size_t expected_nodes, CheckpointState& state) {
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: File: " << path << " not found." << endl;
+        return false;
+    }
+
+    char magic[sizeof(checkpoint_magic)];
+    int64_t nodes = 0;
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, checkpoint_magic, sizeof(magic)) != 0 || !read_value(file, nodes)) {
+        cerr << "Error: " << path << " is not a checkpoint file." << endl;
+        return false;
+    }
+    if (nodes != static_cast<int64_t>(expected_nodes)) {
+        cerr << "Error: checkpoint " << path << " has " << nodes << " nodes, the mesh has " << expected_nodes << "." << endl;
+        return false;
+    }
+
+    state.t_current.resize(nodes);
+    state.t_previous.resize(nodes);
+    bool complete = read_value(file, state.step) && read_value(file, state.time) && read_value(file, state.time_step)
+        && read_value(file, state.previous_step) && read_value(file, state.results_offset) && read_value(file, state.frames_written)
+        && file.read(reinterpret_cast<char*>(state.t_current.data()), nodes * sizeof(double))
+        && file.read(reinterpret_cast<char*>(state.t_previous.data()), nodes * sizeof(double));
+    if (!complete) {
+        cerr << "Error: checkpoint " << path << " is truncated." << endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,345 @@
+#ifdef FEM_OFFLOAD
+
+#include "DeviceSolver.h"
+#include "ElementKernels.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <omp.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::string;
+using std::fixed;
+using std::setprecision;
+using std::floor;
+using std::sqrt;
+using std::fabs;
+
+DeviceSolver::DeviceSolver(Grid& grid, int integration_order)
+    : grid(grid), nodes_count(grid.get_nodes_count()), elements_count(grid.get_elements_count()), nnz(0), solver_tolerance(1e-10),
+      solver_max_iterations(1000), last_iterations(0), results_directory("../Grid/results") {
+    ShapeTableView table = get_shape_table_view(integration_order);
+    points_count = table.points_count;
+    weight.assign(table.weight, table.weight + points_count);
+    N.assign(table.N, table.N + 4 * points_count);
+    dN_dxi.assign(table.dN_dxi, table.dN_dxi + 4 * points_count);
+    dN_deta.assign(table.dN_deta, table.dN_deta + 4 * points_count);
+
+    SparseMatrix pattern;
+    pattern.build_pattern(grid.get_connectivity(), elements_count, 4, nodes_count);
+    row_ptr = pattern.get_row_ptr();
+    col_idx = pattern.get_col_idx();
+    nnz = pattern.nnz();
+
+    H_values.resize(nnz);
+    C_values.resize(nnz);
+    A_values.resize(nnz);
+    for (auto* buffer : { &P, &inv_diagonal, &t, &b, &r, &z, &p, &Ap }) {
+        buffer->resize(nodes_count);
+    }
+
+    // The device copies stay mapped for the lifetime of the solver; the vectors are never resized.
+    // GCC reports the pointers used only in enter/exit data clauses as unused.
+    [[maybe_unused]] const double* x = grid.get_x();
+    [[maybe_unused]] const double* y = grid.get_y();
+    [[maybe_unused]] const int32_t* bc = grid.get_bc();
+    [[maybe_unused]] const int32_t* connectivity = grid.get_connectivity();
+    [[maybe_unused]] double *w = weight.data(), *Nv = N.data(), *dxi = dN_dxi.data(), *deta = dN_deta.data();
+    [[maybe_unused]] int *rows = row_ptr.data(), *cols = col_idx.data();
+    [[maybe_unused]] double *H = H_values.data(), *C = C_values.data(), *A = A_values.data(), *Pv = P.data(), *inv = inv_diagonal.data();
+    [[maybe_unused]] double *tv = t.data(), *bv = b.data(), *rv = r.data(), *zv = z.data(), *pv = p.data(), *Apv = Ap.data();
+    int n = nodes_count, e = elements_count, q = points_count, m = nnz;
+    #pragma omp target enter data map(to: x[0:n], y[0:n], bc[0:n], connectivity[0:4 * e], w[0:q], Nv[0:4 * q], dxi[0:4 * q], deta[0:4 * q], \
+                                          rows[0:n + 1], cols[0:m]) \
+                                   map(alloc: H[0:m], C[0:m], A[0:m], Pv[0:n], inv[0:n], tv[0:n], bv[0:n], rv[0:n], zv[0:n], pv[0:n], Apv[0:n])
+}
+
+DeviceSolver::~DeviceSolver() {
+    [[maybe_unused]] const double* x = grid.get_x();
+    [[maybe_unused]] const double* y = grid.get_y();
+    [[maybe_unused]] const int32_t* bc = grid.get_bc();
+    [[maybe_unused]] const int32_t* connectivity = grid.get_connectivity();
+    [[maybe_unused]] double *w = weight.data(), *Nv = N.data(), *dxi = dN_dxi.data(), *deta = dN_deta.data();
+    [[maybe_unused]] int *rows = row_ptr.data(), *cols = col_idx.data();
+    [[maybe_unused]] double *H = H_values.data(), *C = C_values.data(), *A = A_values.data(), *Pv = P.data(), *inv = inv_diagonal.data();
+    [[maybe_unused]] double *tv = t.data(), *bv = b.data(), *rv = r.data(), *zv = z.data(), *pv = p.data(), *Apv = Ap.data();
+    int n = nodes_count, e = elements_count, q = points_count, m = nnz;
+    #pragma omp target exit data map(delete: x[0:n], y[0:n], bc[0:n], connectivity[0:4 * e], w[0:q], Nv[0:4 * q], dxi[0:4 * q], deta[0:4 * q], \
+                                             rows[0:n + 1], cols[0:m], H[0:m], C[0:m], A[0:m], Pv[0:n], inv[0:n], tv[0:n], bv[0:n], \
+                                             rv[0:n], zv[0:n], pv[0:n], Apv[0:n])
+}
+
+int DeviceSolver::get_devices_count() {
+    return omp_get_num_devices();
+}
+
+void DeviceSolver::set_solver(double tolerance, int max_iterations) {
+    solver_tolerance = tolerance;
+    solver_max_iterations = max_iterations;
+}
+
+void DeviceSolver::set_results_directory(const string& directory) {
+    results_directory = directory;
+}
+
+// One device thread per element, with the arithmetic of FEMSolver::compute_element_matrices.
+// Boundary edges are integrated in closed form (the Gauss rules of calculate_local_Hbc_matrix
+// and calculate_P_vector are exact for them). Element blocks are added to the CSR values with
+// atomics; each row of the pattern has at most 9 entries, so the column search is linear.
+bool DeviceSolver::assemble(double conductivity, double density_specific_heat, double alpha, double ambient_temperature) {
+    PROFILE_SCOPE("device_assembly");
+    const double* x = grid.get_x();
+    const double* y = grid.get_y();
+    const int32_t* bc = grid.get_bc();
+    const int32_t* connectivity = grid.get_connectivity();
+    const double *w = weight.data(), *Nv = N.data(), *dxi = dN_dxi.data(), *deta = dN_deta.data();
+    const int *rows = row_ptr.data(), *cols = col_idx.data();
+    double *H = H_values.data(), *C = C_values.data(), *Pv = P.data();
+    int n = nodes_count, elements = elements_count, q = points_count, m = nnz;
+    int degenerate = 0;
+
+    #pragma omp target teams distribute parallel for
+    for (int k = 0; k < m; ++k) {
+        H[k] = 0.0;
+        C[k] = 0.0;
+    }
+    #pragma omp target teams distribute parallel for
+    for (int i = 0; i < n; ++i) {
+        Pv[i] = 0.0;
+    }
+
+    #pragma omp target teams distribute parallel for reduction(max: degenerate) map(tofrom: degenerate)
+    for (int e = 0; e < elements; ++e) {
+        const int32_t* ID = connectivity + 4 * e;
+        double xs[4], ys[4];
+        for (int k = 0; k < 4; ++k) {
+            xs[k] = x[ID[k]];
+            ys[k] = y[ID[k]];
+        }
+
+        double H_local[16] = {}, C_local[16] = {};
+        for (int point = 0; point < q; ++point) {
+            const double* dN_dxi_p = dxi + 4 * point;
+            const double* dN_deta_p = deta + 4 * point;
+            const double* N_p = Nv + 4 * point;
+            double J00 = 0.0, J01 = 0.0, J10 = 0.0, J11 = 0.0;
+            for (int k = 0; k < 4; ++k) {
+                J00 += dN_dxi_p[k] * xs[k];
+                J01 += dN_deta_p[k] * xs[k];
+                J10 += dN_dxi_p[k] * ys[k];
+                J11 += dN_deta_p[k] * ys[k];
+            }
+            double detJ = J00 * J11 - J01 * J10;
+            if (fabs(detJ) < 1e-12) {
+                degenerate = 1;
+                break;
+            }
+
+            double dN_dx[4], dN_dy[4];
+            for (int k = 0; k < 4; ++k) {
+                dN_dx[k] = (J11 * dN_dxi_p[k] - J10 * dN_deta_p[k]) / detJ;
+                dN_dy[k] = (-J01 * dN_dxi_p[k] + J00 * dN_deta_p[k]) / detJ;
+            }
+            double point_weight = w[point] * detJ;
+            for (int i = 0; i < 4; ++i) {
+                for (int j = i; j < 4; ++j) {
+                    H_local[i * 4 + j] += conductivity * (dN_dx[i] * dN_dx[j] + dN_dy[i] * dN_dy[j]) * point_weight;
+                    C_local[i * 4 + j] += density_specific_heat * N_p[i] * N_p[j] * point_weight;
+                }
+            }
+        }
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < i; ++j) {
+                H_local[i * 4 + j] = H_local[j * 4 + i];
+                C_local[i * 4 + j] = C_local[j * 4 + i];
+            }
+        }
+
+        for (int edge = 0; edge < 4; ++edge) {
+            int a = edge, c = (edge + 1) % 4;
+            if (bc[ID[a]] && bc[ID[c]]) {
+                double dx = xs[c] - xs[a], dy = ys[c] - ys[a];
+                double L = sqrt(dx * dx + dy * dy);
+                H_local[a * 4 + a] += alpha * L / 3.0;
+                H_local[c * 4 + c] += alpha * L / 3.0;
+                H_local[a * 4 + c] += alpha * L / 6.0;
+                H_local[c * 4 + a] += alpha * L / 6.0;
+                double load = 0.5 * alpha * ambient_temperature * L;
+                #pragma omp atomic update
+                Pv[ID[a]] += load;
+                #pragma omp atomic update
+                Pv[ID[c]] += load;
+            }
+        }
+
+        for (int i = 0; i < 4; ++i) {
+            int row = ID[i];
+            for (int j = 0; j < 4; ++j) {
+                int k = rows[row];
+                while (cols[k] != ID[j]) {
+                    ++k;
+                }
+                #pragma omp atomic update
+                H[k] += H_local[i * 4 + j];
+                #pragma omp atomic update
+                C[k] += C_local[i * 4 + j];
+            }
+        }
+    }
+
+    PROFILE_COUNTER("device_assembly", "nnz", m);
+    if (degenerate) {
+        cerr << "Error: Degenerate element Jacobian in the device assembly." << endl;
+        return false;
+    }
+    return true;
+}
+
+double DeviceSolver::dot(const double* x, const double* y) const {
+    int n = nodes_count;
+    double sum = 0.0;
+    #pragma omp target teams distribute parallel for reduction(+: sum) map(tofrom: sum)
+    for (int i = 0; i < n; ++i) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+void DeviceSolver::multiply(const double* values, const double* x, double* y) const {
+    const int *rows = row_ptr.data(), *cols = col_idx.data();
+    int n = nodes_count;
+    #pragma omp target teams distribute parallel for
+    for (int row = 0; row < n; ++row) {
+        double sum = 0.0;
+        for (int k = rows[row]; k < rows[row + 1]; ++k) {
+            sum += values[k] * x[cols[k]];
+        }
+        y[row] = sum;
+    }
+}
+
+// Same iteration as PCGSolver with the Jacobi preconditioner, warm-started from t.
+bool DeviceSolver::solve() {
+    const double *A = A_values.data(), *inv = inv_diagonal.data(), *bv = b.data();
+    double *tv = t.data(), *rv = r.data(), *zv = z.data(), *pv = p.data(), *Apv = Ap.data();
+    int n = nodes_count;
+
+    multiply(A, tv, Apv);
+    #pragma omp target teams distribute parallel for
+    for (int i = 0; i < n; ++i) {
+        rv[i] = bv[i] - Apv[i];
+        zv[i] = inv[i] * rv[i];
+        pv[i] = zv[i];
+    }
+
+    double b_norm = sqrt(dot(bv, bv));
+    if (b_norm == 0.0) {
+        b_norm = 1.0;
+    }
+    double rz = dot(rv, zv);
+    double residual = sqrt(dot(rv, rv)) / b_norm;
+    last_iterations = 0;
+
+    while (residual > solver_tolerance && last_iterations < solver_max_iterations) {
+        multiply(A, pv, Apv);
+        double step = rz / dot(pv, Apv);
+        #pragma omp target teams distribute parallel for
+        for (int i = 0; i < n; ++i) {
+            tv[i] += step * pv[i];
+            rv[i] -= step * Apv[i];
+            zv[i] = inv[i] * rv[i];
+        }
+        double rz_new = dot(rv, zv);
+        double beta = rz_new / rz;
+        rz = rz_new;
+        #pragma omp target teams distribute parallel for
+        for (int i = 0; i < n; ++i) {
+            pv[i] = zv[i] + beta * pv[i];
+        }
+        residual = sqrt(dot(rv, rv)) / b_norm;
+        ++last_iterations;
+    }
+
+    if (residual > solver_tolerance) {
+        cerr << "PCG did not converge: residual " << residual << " after " << last_iterations << " iterations." << endl;
+        return false;
+    }
+    return true;
+}
+
+bool DeviceSolver::simulate_time(double initial_temperature, double time_step, double total_time, ResultFormat format, const OutputOptions& output) {
+    const double *H = H_values.data(), *C = C_values.data(), *Pv = P.data();
+    const int *rows = row_ptr.data(), *cols = col_idx.data();
+    double *A = A_values.data(), *inv = inv_diagonal.data(), *tv = t.data(), *bv = b.data(), *Apv = Ap.data();
+    int n = nodes_count, m = nnz;
+    double inv_dt = 1.0 / time_step;
+
+    #pragma omp target teams distribute parallel for
+    for (int k = 0; k < m; ++k) {
+        A[k] = C[k] * inv_dt + H[k];
+    }
+    #pragma omp target teams distribute parallel for
+    for (int row = 0; row < n; ++row) {
+        double diagonal = 0.0;
+        for (int k = rows[row]; k < rows[row + 1]; ++k) {
+            if (cols[k] == row) {
+                diagonal = A[k];
+            }
+        }
+        inv[row] = diagonal != 0.0 ? 1.0 / diagonal : 1.0;
+        tv[row] = initial_temperature;
+    }
+
+    ResultWriter writer;
+    writer.set_options(output);
+    string path = results_directory + "/simulation_temperatures" + (format == ResultFormat::Binary ? ".bin" : ".txt");
+    writer.set_node_order(grid.get_node_permutation());
+    if (!writer.open(path, format, nodes_count, time_step)) {
+        return false;
+    }
+
+    int steps_count = static_cast<int>(floor(total_time / time_step + 1e-9));
+    cout << fixed << setprecision(5);
+    for (int step = 1; step <= steps_count; ++step) {
+        PROFILE_SCOPE("device_time_step");
+        double time = step * time_step;
+        multiply(C, tv, Apv);
+        #pragma omp target teams distribute parallel for
+        for (int i = 0; i < n; ++i) {
+            bv[i] = Pv[i] + Apv[i] * inv_dt;
+        }
+        if (!solve()) {
+            cerr << "Error: the linear solve failed at time " << time << " s, the run was stopped." << endl;
+            writer.close();
+            return false;
+        }
+        PROFILE_COUNTER("device_time_step", "iterations", last_iterations);
+
+        if (!writer.is_frame_due(time)) {
+            writer.write_frame(time, t);
+            continue;
+        }
+        #pragma omp target update from(tv[0:n])
+        if (!Logger::enabled(LogLevel::Info)) {
+            writer.write_frame(time, t);
+        } else {
+            FieldStats stats = compute_field_stats(t);
+            writer.write_frame(time, t, stats);
+            cout << "Time: " << time << " s" << endl;
+            cout << "Minimum Temperature: " << stats.min << endl;
+            cout << "Maximum Temperature: " << stats.max << endl;
+        }
+    }
+    writer.close();
+    return true;
+}
+
+#endif // FEM_OFFLOAD
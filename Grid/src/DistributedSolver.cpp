@@ -0,0 +1,349 @@
+#ifdef FEM_MPI
+
+#include "DistributedSolver.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::string;
+using std::fixed;
+using std::setprecision;
+using std::make_unique;
+using std::sort;
+using std::any_of;
+using std::unique;
+using std::upper_bound;
+using std::sqrt;
+using std::floor;
+using std::move;
+
+DistributedSolver::DistributedSolver(Grid& grid, MPI_Comm p_comm, double alpha, int thread_count)
+    : comm(p_comm), global_grid(grid), owned_count(0), solver_tolerance(1e-10), solver_max_iterations(1000), last_iterations(0),
+      results_directory("../Grid/results") {
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &ranks_count);
+    build_partition();
+    build_halo();
+
+    local_solver = make_unique<FEMSolver>(*local_grid, alpha, 0.0);
+    local_solver->set_thread_count(thread_count);
+    local_solver->set_write_intermediate(false);
+}
+
+void DistributedSolver::build_partition() {
+    int nodes_count = global_grid.get_nodes_count();
+    int elements_count = global_grid.get_elements_count();
+    offsets.resize(ranks_count + 1);
+    for (int r = 0; r <= ranks_count; ++r) {
+        offsets[r] = static_cast<int>(static_cast<int64_t>(nodes_count) * r / ranks_count);
+    }
+    int first = offsets[rank], last = offsets[rank + 1];
+    owned_count = last - first;
+
+    int nodes_per_element = global_grid.get_nodes_per_element();
+    auto owned = [&](int32_t node) { return node >= first && node < last; };
+    vector<int32_t> elements, ghosts;
+    for (int e = 0; e < elements_count; ++e) {
+        const int32_t* ID = global_grid.get_element_nodes(e);
+        if (any_of(ID, ID + nodes_per_element, owned)) {
+            elements.push_back(e);
+            for (int k = 0; k < nodes_per_element; ++k) {
+                if (!owned(ID[k])) {
+                    ghosts.push_back(ID[k]);
+                }
+            }
+        }
+    }
+    sort(ghosts.begin(), ghosts.end());
+    ghosts.erase(unique(ghosts.begin(), ghosts.end()), ghosts.end());
+
+    local_to_global.resize(owned_count + ghosts.size());
+    for (int i = 0; i < owned_count; ++i) {
+        local_to_global[i] = first + i;
+    }
+    std::copy(ghosts.begin(), ghosts.end(), local_to_global.begin() + owned_count);
+
+    auto to_local = [&](int32_t node) {
+        if (owned(node)) {
+            return node - first;
+        }
+        return owned_count + static_cast<int>(std::lower_bound(ghosts.begin(), ghosts.end(), node) - ghosts.begin());
+    };
+
+    size_t local_nodes = local_to_global.size();
+    vector<double> x(local_nodes), y(local_nodes);
+    vector<int32_t> bc(local_nodes), connectivity;
+    for (size_t i = 0; i < local_nodes; ++i) {
+        x[i] = global_grid.get_x()[local_to_global[i]];
+        y[i] = global_grid.get_y()[local_to_global[i]];
+        bc[i] = global_grid.get_bc()[local_to_global[i]];
+    }
+    connectivity.reserve(nodes_per_element * elements.size());
+    for (int32_t e : elements) {
+        const int32_t* ID = global_grid.get_element_nodes(e);
+        for (int k = 0; k < nodes_per_element; ++k) {
+            connectivity.push_back(to_local(ID[k]));
+        }
+    }
+    local_grid = make_unique<Grid>(move(x), move(y), move(bc), move(connectivity), global_grid.get_element_type());
+}
+
+void DistributedSolver::build_halo() {
+    // Ghosts are sorted by global index, so the ghosts of each owner rank are contiguous.
+    vector<int> receive_counts(ranks_count, 0);
+    for (size_t i = owned_count; i < local_to_global.size(); ++i) {
+        int owner = upper_bound(offsets.begin(), offsets.end(), local_to_global[i]) - offsets.begin() - 1;
+        receive_counts[owner]++;
+    }
+    vector<int> send_counts(ranks_count, 0);
+    MPI_Alltoall(receive_counts.data(), 1, MPI_INT, send_counts.data(), 1, MPI_INT, comm);
+
+    neighbours.clear();
+    receive_offsets.assign(1, owned_count);
+    send_indices.clear();
+    vector<MPI_Request> requests;
+    int ghost = owned_count;
+    for (int r = 0; r < ranks_count; ++r) {
+        if (receive_counts[r] == 0 && send_counts[r] == 0) {
+            continue;
+        }
+        neighbours.push_back(r);
+        ghost += receive_counts[r];
+        receive_offsets.push_back(ghost);
+        send_indices.emplace_back(send_counts[r]);
+    }
+
+    // Each rank tells the owners which of their nodes it needs, as global indices.
+    for (size_t k = 0; k < neighbours.size(); ++k) {
+        int count = receive_offsets[k + 1] - receive_offsets[k];
+        if (count > 0) {
+            requests.emplace_back();
+            MPI_Isend(&local_to_global[receive_offsets[k]], count, MPI_INT32_T, neighbours[k], 0, comm, &requests.back());
+        }
+        if (!send_indices[k].empty()) {
+            requests.emplace_back();
+            MPI_Irecv(send_indices[k].data(), send_indices[k].size(), MPI_INT32_T, neighbours[k], 0, comm, &requests.back());
+        }
+    }
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+    send_buffers.resize(neighbours.size());
+    for (size_t k = 0; k < neighbours.size(); ++k) {
+        for (auto& index : send_indices[k]) {
+            index -= offsets[rank];
+        }
+        send_buffers[k].resize(send_indices[k].size());
+    }
+    halo_x.assign(local_to_global.size(), 0.0);
+}
+
+void DistributedSolver::exchange_halo(const vector<double>& x_owned) {
+    std::copy(x_owned.begin(), x_owned.end(), halo_x.begin());
+
+    vector<MPI_Request> requests;
+    requests.reserve(2 * neighbours.size());
+    for (size_t k = 0; k < neighbours.size(); ++k) {
+        int count = receive_offsets[k + 1] - receive_offsets[k];
+        if (count > 0) {
+            requests.emplace_back();
+            MPI_Irecv(&halo_x[receive_offsets[k]], count, MPI_DOUBLE, neighbours[k], 1, comm, &requests.back());
+        }
+    }
+    for (size_t k = 0; k < neighbours.size(); ++k) {
+        if (send_indices[k].empty()) {
+            continue;
+        }
+        for (size_t i = 0; i < send_indices[k].size(); ++i) {
+            send_buffers[k][i] = x_owned[send_indices[k][i]];
+        }
+        requests.emplace_back();
+        MPI_Isend(send_buffers[k].data(), send_buffers[k].size(), MPI_DOUBLE, neighbours[k], 1, comm, &requests.back());
+    }
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+}
+
+// Only the owned rows of the local matrices are complete; ghost rows are never used.
+void DistributedSolver::multiply(const SparseMatrix& A, const vector<double>& x_owned, vector<double>& y_owned) {
+    exchange_halo(x_owned);
+    const auto& row_ptr = A.get_row_ptr();
+    const auto& col_idx = A.get_col_idx();
+    const auto& values = A.get_values();
+    y_owned.resize(owned_count);
+    for (int row = 0; row < owned_count; ++row) {
+        double sum = 0.0;
+        for (int k = row_ptr[row]; k < row_ptr[row + 1]; ++k) {
+            sum += values[k] * halo_x[col_idx[k]];
+        }
+        y_owned[row] = sum;
+    }
+}
+
+double DistributedSolver::dot(const vector<double>& a, const vector<double>& b) const {
+    double local = 0.0, global = 0.0;
+    for (int i = 0; i < owned_count; ++i) {
+        local += a[i] * b[i];
+    }
+    MPI_Allreduce(&local, &global, 1, MPI_DOUBLE, MPI_SUM, comm);
+    return global;
+}
+
+void DistributedSolver::prepare_solver(const SparseMatrix& A) {
+    inv_diagonal.resize(owned_count);
+    for (int i = 0; i < owned_count; ++i) {
+        int k = A.find(i, i);
+        double diagonal = k >= 0 ? A.get_values()[k] : 0.0;
+        inv_diagonal[i] = diagonal != 0.0 ? 1.0 / diagonal : 1.0;
+    }
+}
+
+// Same iteration as PCGSolver with the Jacobi preconditioner.
+bool DistributedSolver::solve(const vector<double>& b, vector<double>& x) {
+    r.resize(owned_count);
+    z.resize(owned_count);
+    p.resize(owned_count);
+    multiply(A_local, x, Ap);
+    for (int i = 0; i < owned_count; ++i) {
+        r[i] = b[i] - Ap[i];
+        z[i] = inv_diagonal[i] * r[i];
+    }
+    p = z;
+
+    double b_norm = sqrt(dot(b, b));
+    if (b_norm == 0.0) {
+        b_norm = 1.0;
+    }
+    double rz = dot(r, z);
+    double residual = sqrt(dot(r, r)) / b_norm;
+    last_iterations = 0;
+
+    while (residual > solver_tolerance && last_iterations < solver_max_iterations) {
+        multiply(A_local, p, Ap);
+        double alpha = rz / dot(p, Ap);
+        for (int i = 0; i < owned_count; ++i) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+            z[i] = inv_diagonal[i] * r[i];
+        }
+        double rz_new = dot(r, z);
+        double beta = rz_new / rz;
+        rz = rz_new;
+        for (int i = 0; i < owned_count; ++i) {
+            p[i] = z[i] + beta * p[i];
+        }
+        residual = sqrt(dot(r, r)) / b_norm;
+        ++last_iterations;
+    }
+
+    if (residual > solver_tolerance) {
+        if (rank == 0) {
+            cerr << "PCG did not converge: residual " << residual << " after " << last_iterations << " iterations." << endl;
+        }
+        return false;
+    }
+    return true;
+}
+
+void DistributedSolver::gather(const vector<double>& x_owned, vector<double>& x_global) const {
+    vector<int> counts(ranks_count);
+    for (int r = 0; r < ranks_count; ++r) {
+        counts[r] = offsets[r + 1] - offsets[r];
+    }
+    if (rank == 0) {
+        x_global.resize(offsets[ranks_count]);
+    }
+    MPI_Gatherv(x_owned.data(), owned_count, MPI_DOUBLE, x_global.data(), counts.data(), offsets.data(), MPI_DOUBLE, 0, comm);
+}
+
+void DistributedSolver::set_solver(double tolerance, int max_iterations) {
+    solver_tolerance = tolerance;
+    solver_max_iterations = max_iterations;
+}
+
+void DistributedSolver::set_results_directory(const string& directory) {
+    results_directory = directory;
+}
+
+void DistributedSolver::assemble(double conductivity, double density, double specific_heat, double alpha, double ambient_temperature) {
+    int local_nodes = local_grid->get_nodes_count();
+    vector<double> P_local;
+    local_solver->calculate_local_matrices(conductivity, density, specific_heat);
+    local_solver->aggregate_Hbc_matrix(H_local, local_nodes);
+    local_solver->aggregate_C_matrix(C_local, local_nodes);
+    local_solver->calculate_P_vector(alpha, ambient_temperature);
+    local_solver->aggregate_P_vector(P_local, local_nodes);
+    P_owned.assign(P_local.begin(), P_local.begin() + owned_count);
+}
+
+bool DistributedSolver::simulate_time(double initial_temperature, double time_step, double total_time, ResultFormat format, const OutputOptions& output) {
+    A_local = C_local;
+    A_local.scale(1.0 / time_step);
+    A_local.add_scaled(H_local, 1.0);
+    prepare_solver(A_local);
+
+    int global_nodes = offsets[ranks_count];
+    // Every rank follows the output schedule, so only the written steps are gathered.
+    ResultWriter writer;
+    writer.set_options(output);
+    int writer_open = 1;
+    if (rank == 0) {
+        string path = results_directory + "/simulation_temperatures" + (format == ResultFormat::Binary ? ".bin" : ".txt");
+        writer.set_node_order(global_grid.get_node_permutation());
+        writer_open = writer.open(path, format, global_nodes, time_step) ? 1 : 0;
+    }
+    MPI_Bcast(&writer_open, 1, MPI_INT, 0, comm);
+    if (!writer_open) {
+        return false;
+    }
+
+    vector<double> t_current(owned_count, initial_temperature), t_next, b(owned_count), Ct, t_global;
+    int steps_count = static_cast<int>(floor(total_time / time_step + 1e-9));
+    cout << fixed << setprecision(5);
+    for (int step = 1; step <= steps_count; ++step) {
+        double time = step * time_step;
+        multiply(C_local, t_current, Ct);
+        for (int i = 0; i < owned_count; ++i) {
+            b[i] = P_owned[i] + Ct[i] / time_step;
+        }
+        t_next = t_current;
+        // Convergence is decided on the reduced residual, so every rank stops at the same step.
+        if (!solve(b, t_next)) {
+            if (rank == 0) {
+                cerr << "Error: the linear solve failed at time " << time << " s, the run was stopped." << endl;
+            }
+            writer.close();
+            return false;
+        }
+        t_current.swap(t_next);
+
+        if (!writer.is_frame_due(time)) {
+            writer.write_frame(time, t_global);
+            continue;
+        }
+        gather(t_current, t_global);
+        if (rank != 0 || !Logger::enabled(LogLevel::Info)) {
+            writer.write_frame(time, t_global);
+        } else {
+            FieldStats stats = compute_field_stats(t_global);
+            writer.write_frame(time, t_global, stats);
+            cout << "Time: " << time << " s" << endl;
+            cout << "Minimum Temperature: " << stats.min << endl;
+            cout << "Maximum Temperature: " << stats.max << endl;
+        }
+    }
+    writer.close();
+    return true;
+}
+
+int DistributedSolver::get_owned_count() const { return owned_count; }
+int DistributedSolver::get_ghost_count() const { return local_to_global.size() - owned_count; }
+
+#endif // FEM_MPI
@@ -1,58 +1,39 @@
 #include "Element.h"
-#include "Integration.h"
-#include <cmath>
-#include <vector>
 
 using std::cout;
-using std::cerr;
 using std::endl;
-using std::vector;
-
-Element::Element(const Node& n1, const Node& n2, const Node& n3, const Node& n4) {
-    nodes_xy[0] = n1;
-    nodes_xy[1] = n2;
-    nodes_xy[2] = n3;
-    nodes_xy[3] = n4;
-    ID.resize(4, 0);
-    Hbc.resize(4, vector<double>(4, 0.0));
-    P.resize(4, 0.0);
-}
 
-const Node* Element::get_nodes() const {
-    return nodes_xy;
+Element::Element(const int32_t* p_ID, const double* p_x, const double* p_y, const int32_t* p_bc, int p_nodes_count)
+    : ID(p_ID), x(p_x), y(p_y), bc(p_bc), nodes_count(p_nodes_count) {}
+
+int Element::get_nodes_count() const {
+    return nodes_count;
 }
 
-const vector<int>& Element::get_ID() const {
+const int32_t* Element::get_ID() const {
     return ID;
 }
 
-void Element::set_ID(int node_1, int node_2, int node_3, int node_4) {
-    ID[0] = node_1;
-    ID[1] = node_2;
-    ID[2] = node_3;
-    ID[3] = node_4;
+double Element::get_x(int local_node) const {
+    return x[ID[local_node]];
 }
 
-void Element::display_ID() const {
-    cout << "Element ID: ";
-    for (size_t i = 0; i < ID.size(); i++) { 
-        cout << ID[i] << " ";
-    }
-    cout << endl;
+double Element::get_y(int local_node) const {
+    return y[ID[local_node]];
 }
 
-void Element::set_Hbc(const vector<vector<double>>& hbc) {
-     Hbc = hbc; 
+int Element::get_BC(int local_node) const {
+    return bc[ID[local_node]];
 }
 
-const vector<vector<double>>& Element::get_Hbc() const { 
-    return Hbc; 
+Node Element::get_node(int local_node) const {
+    return Node(get_x(local_node), get_y(local_node), get_BC(local_node));
 }
 
-void Element::set_P(const vector<double>& p) {
-    P = p;
+void Element::display_ID() const {
+    cout << "Element ID: ";
+    for (int i = 0; i < nodes_count; i++) { 
+        cout << ID[i] << " ";
+    }
+    cout << endl;
 }
-
-const vector<double>& Element::get_P() const {
-    return P;
-}
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "ElementKernels.h"
+#include "UniversalElement.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+using std::abs;
+using std::string;
+using std::invalid_argument;
+using std::to_string;
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FEM_X86_KERNELS 1
+#endif
+
+namespace {
+
+template <int Order>
+ShapeTableView make_view(const ShapeFunctionTable<Order>& table) {
+    return { table.points_count, table.weight, &table.N[0][0], &table.dN_dxi[0][0], &table.dN_deta[0][0] };
+}
+
+#ifdef FEM_X86_KERNELS
+#define FEM_ALWAYS_INLINE inline __attribute__((always_inline))
+
+typedef double v4d __attribute__((vector_size(32)));
+typedef double v8d __attribute__((vector_size(64)));
+
+// Same arithmetic as FEMSolver::compute_element_matrices, with every element of the batch
+// held in its own SIMD lane. H and C are symmetric, so only the upper triangle is accumulated.
+template <typename V, int Width>
+FEM_ALWAYS_INLINE bool compute_batch(const ShapeTableView& table, const double* x, const double* y, const int32_t* connectivity,
+                                     long first, double conductivity, double density_specific_heat, double* H, double* C) {
+    V xs[4], ys[4];
+    for (int k = 0; k < 4; ++k) {
+        for (int lane = 0; lane < Width; ++lane) {
+            int32_t node = connectivity[(first + lane) * 4 + k];
+            xs[k][lane] = x[node];
+            ys[k][lane] = y[node];
+        }
+    }
+
+    V H_acc[10] = {}, C_acc[10] = {};
+
+    for (int p = 0; p < table.points_count; ++p) {
+        const double* N = table.N + p * 4;
+        const double* dN_dxi = table.dN_dxi + p * 4;
+        const double* dN_deta = table.dN_deta + p * 4;
+
+        V J00 = {}, J01 = {}, J10 = {}, J11 = {};
+        for (int k = 0; k < 4; ++k) {
+            J00 += dN_dxi[k] * xs[k];
+            J01 += dN_deta[k] * xs[k];
+            J10 += dN_dxi[k] * ys[k];
+            J11 += dN_deta[k] * ys[k];
+        }
+        V detJ = J00 * J11 - J01 * J10;
+
+        for (int lane = 0; lane < Width; ++lane) {
+            if (abs(detJ[lane]) < 1e-12) {
+                return false;
+            }
+        }
+
+        V inv00 = J11 / detJ;
+        V inv01 = -J01 / detJ;
+        V inv10 = -J10 / detJ;
+        V inv11 = J00 / detJ;
+
+        V dN_dx[4], dN_dy[4];
+        for (int k = 0; k < 4; ++k) {
+            dN_dx[k] = inv00 * dN_dxi[k] + inv10 * dN_deta[k];
+            dN_dy[k] = inv01 * dN_dxi[k] + inv11 * dN_deta[k];
+        }
+
+        V weight = table.weight[p] * detJ;
+        int idx = 0;
+        for (int i = 0; i < 4; ++i) {
+            for (int j = i; j < 4; ++j, ++idx) {
+                H_acc[idx] += conductivity * (dN_dx[i] * dN_dx[j] + dN_dy[i] * dN_dy[j]) * weight;
+                if (C != nullptr) {
+                    C_acc[idx] += density_specific_heat * N[i] * N[j] * weight;
+                }
+            }
+        }
+    }
+
+    for (int lane = 0; lane < Width; ++lane) {
+        double* H_local = H + 16 * (first + lane);
+        double* C_local = C != nullptr ? C + 16 * (first + lane) : nullptr;
+        int idx = 0;
+        for (int i = 0; i < 4; ++i) {
+            for (int j = i; j < 4; ++j, ++idx) {
+                H_local[i * 4 + j] = H_local[j * 4 + i] = H_acc[idx][lane];
+                if (C_local != nullptr) {
+                    C_local[i * 4 + j] = C_local[j * 4 + i] = C_acc[idx][lane];
+                }
+            }
+        }
+    }
+    return true;
+}
+
+__attribute__((target("avx2,fma")))
+bool compute_batch_avx2(const ShapeTableView& table, const double* x, const double* y, const int32_t* connectivity,
+                        long first, double conductivity, double density_specific_heat, double* H, double* C) {
+    return compute_batch<v4d, 4>(table, x, y, connectivity, first, conductivity, density_specific_heat, H, C);
+}
+
+__attribute__((target("avx512f")))
+bool compute_batch_avx512(const ShapeTableView& table, const double* x, const double* y, const int32_t* connectivity,
+                          long first, double conductivity, double density_specific_heat, double* H, double* C) {
+    return compute_batch<v8d, 8>(table, x, y, connectivity, first, conductivity, density_specific_heat, H, C);
+}
+#endif
+
+bool cpu_supports(KernelType type) {
+#ifdef FEM_X86_KERNELS
+    __builtin_cpu_init();
+    switch (type) {
+        case KernelType::AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case KernelType::AVX512:
+            return __builtin_cpu_supports("avx512f");
+        default:
+            return true;
+    }
+#else
+    return type == KernelType::Scalar;
+#endif
+}
+
+}
+
+ShapeTableView get_shape_table_view(int order) {
+    switch (order) {
+        case 2:
+            return make_view(shape_function_table<2>);
+        case 3:
+            return make_view(shape_function_table<3>);
+        case 4:
+            return make_view(shape_function_table<4>);
+        case 9:
+            return make_view(shape_function_table<9>);
+        case 16:
+            return make_view(shape_function_table<16>);
+        default:
+            throw invalid_argument("Unsupported integration order: " + to_string(order));
+    }
+}
+
+KernelType resolve_kernel_type(KernelType requested) {
+    if (requested == KernelType::Auto) {
+        if (cpu_supports(KernelType::AVX512)) {
+            return KernelType::AVX512;
+        }
+        if (cpu_supports(KernelType::AVX2)) {
+            return KernelType::AVX2;
+        }
+        return KernelType::Scalar;
+    }
+    return cpu_supports(requested) ? requested : KernelType::Scalar;
+}
+
+int get_kernel_batch_width(KernelType type) {
+    switch (type) {
+        case KernelType::AVX2:
+            return 4;
+        case KernelType::AVX512:
+            return 8;
+        default:
+            return 1;
+    }
+}
+
+string get_kernel_name(KernelType type) {
+    switch (type) {
+        case KernelType::Auto:
+            return "auto";
+        case KernelType::AVX2:
+            return "avx2";
+        case KernelType::AVX512:
+            return "avx512";
+        default:
+            return "scalar";
+    }
+}
+
+bool parse_kernel_type(const string& name, KernelType& type) {
+    if (name == "auto") {
+        type = KernelType::Auto;
+    } else if (name == "scalar") {
+        type = KernelType::Scalar;
+    } else if (name == "avx2") {
+        type = KernelType::AVX2;
+    } else if (name == "avx512") {
+        type = KernelType::AVX512;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool compute_element_batch(KernelType type, const ShapeTableView& table, const double* x, const double* y, const int32_t* connectivity,
+                           long first, double conductivity, double density_specific_heat, double* H, double* C) {
+#ifdef FEM_X86_KERNELS
+    switch (type) {
+        case KernelType::AVX2:
+            return compute_batch_avx2(table, x, y, connectivity, first, conductivity, density_specific_heat, H, C);
+        case KernelType::AVX512:
+            return compute_batch_avx512(table, x, y, connectivity, first, conductivity, density_specific_heat, H, C);
+        default:
+            return false;
+    }
+#else
+    return false;
+#endif
+}
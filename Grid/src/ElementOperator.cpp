@@ -0,0 +1,73 @@
+#include "ElementOperator.h"
+#include <vector>
+
+using std::vector;
+
+ElementOperator::ElementOperator(Grid& grid, int thread_count)
+    : connectivity(grid.get_connectivity()), elements_count(grid.get_elements_count()), nodes_count(grid.get_nodes_count()),
+      nodes_per_element(grid.get_nodes_per_element()), thread_count(thread_count), element_colors(thread_count > 1 ? &grid.get_element_colors() : nullptr) {}
+
+void ElementOperator::add_term(const vector<double>& blocks, double scale) {
+    terms.push_back({ blocks.data(), scale });
+}
+
+int ElementOperator::size() const { return nodes_count; }
+
+void ElementOperator::apply_element(int element, const vector<double>& x, vector<double>& y) const {
+    int n = nodes_per_element;
+    const int32_t* ID = &connectivity[static_cast<long>(n) * element];
+    double x_local[max_element_nodes], y_local[max_element_nodes];
+    for (int i = 0; i < n; ++i) {
+        x_local[i] = x[ID[i]];
+        y_local[i] = 0.0;
+    }
+
+    for (const auto& term : terms) {
+        const double* block = term.blocks + static_cast<long>(n) * n * element;
+        for (int i = 0; i < n; ++i) {
+            double sum = 0.0;
+            for (int j = 0; j < n; ++j) {
+                sum += block[i * n + j] * x_local[j];
+            }
+            y_local[i] += term.scale * sum;
+        }
+    }
+
+    for (int i = 0; i < n; ++i) {
+        y[ID[i]] += y_local[i];
+    }
+}
+
+void ElementOperator::apply(const vector<double>& x, vector<double>& y) const {
+    y.assign(nodes_count, 0.0);
+
+    if (element_colors == nullptr) {
+        for (int e = 0; e < elements_count; ++e) {
+            apply_element(e, x, y);
+        }
+        return;
+    }
+
+    for (const auto& color : *element_colors) {
+        long color_size = color.size();
+
+        #pragma omp parallel for num_threads(thread_count) schedule(static)
+        for (long c = 0; c < color_size; ++c) {
+            apply_element(color[c], x, y);
+        }
+    }
+}
+
+void ElementOperator::get_diagonal(vector<double>& diagonal) const {
+    diagonal.assign(nodes_count, 0.0);
+    for (int e = 0; e < elements_count; ++e) {
+        int n = nodes_per_element;
+        const int32_t* ID = &connectivity[static_cast<long>(n) * e];
+        for (const auto& term : terms) {
+            const double* block = term.blocks + static_cast<long>(n) * n * e;
+            for (int i = 0; i < n; ++i) {
+                diagonal[ID[i]] += term.scale * block[i * n + i];
+            }
+        }
+    }
+}
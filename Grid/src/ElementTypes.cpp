@@ -0,0 +1,45 @@
+#include "ElementTypes.h"
+#include <string>
+
+using std::string;
+
+int get_element_nodes_count(ElementType type) {
+    switch (type) {
+    case ElementType::Quad8:
+        return ElementTraits<ElementType::Quad8>::nodes;
+    case ElementType::Quad9:
+        return ElementTraits<ElementType::Quad9>::nodes;
+    case ElementType::Tri3:
+        return ElementTraits<ElementType::Tri3>::nodes;
+    default:
+        return ElementTraits<ElementType::Quad4>::nodes;
+    }
+}
+
+string get_element_type_name(ElementType type) {
+    switch (type) {
+    case ElementType::Quad8:
+        return "quad8";
+    case ElementType::Quad9:
+        return "quad9";
+    case ElementType::Tri3:
+        return "tri3";
+    default:
+        return "quad4";
+    }
+}
+
+bool parse_element_type(const string& name, ElementType& type) {
+    if (name == "quad4") {
+        type = ElementType::Quad4;
+    } else if (name == "quad8") {
+        type = ElementType::Quad8;
+    } else if (name == "quad9") {
+        type = ElementType::Quad9;
+    } else if (name == "tri3") {
+        type = ElementType::Tri3;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -2,30 +2,167 @@
 #include "Integration.h"
 #include "Element.h"
 #include "Grid.h"
+#include "LinearSolver.h"
+#include "Logger.h"
+#include "ResultWriter.h"
+#include "ElementOperator.h"
+#include "Profiler.h"
 #include <cmath>
 #include <vector>
 #include <iomanip> 
 #include <fstream>
 #include <algorithm>
+#include <string>
+#include <limits>
+#include <map>
+#include <memory>
+#include <functional>
+#include <utility>
+#include <stdexcept>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using std::abs;
 using std::cout;
 using std::cerr;
 using std::endl;
-using std::swap;
 using std::vector;
 using std::fill;
 using std::fixed;
 using std::setprecision;
 using std::ofstream;
-using std::min_element;
-using std::max_element;
+using std::string;
+using std::max;
+using std::ceil;
+using std::floor;
+using std::numeric_limits;
+using std::min;
+using std::map;
+using std::function;
+using std::make_unique;
+using std::move;
+using std::to_string;
+using std::invalid_argument;
+using std::unique_ptr;
+
+namespace {
+
+// Floating point operations per element and quadrature point of compute_element_batch,
+// used for the profiler's flop counters: Jacobian and inverse, shape derivatives, and the
+// upper triangle of H (and C).
+const double H_flops_per_point = 110.0;
+const double HC_flops_per_point = 150.0;
+
+// A lagged factorization is renewed when a nonlinear correction is not at least this much
+// smaller than the previous one.
+const double lagged_convergence_rate = 0.5;
+
+template <typename Matrix>
+bool factorize_profiled(LinearSolver& linear_solver, const Matrix& A) {
+    PROFILE_SCOPE("factorization");
+    return linear_solver.factorize(A);
+}
+
+}
 
-FEMSolver::FEMSolver(Grid& grid, double alpha, double ambient_temperature) : grid(grid) {
-    local_H_matrices.resize(grid.get_elements().size(), vector<double>(4, 0.0));
+FEMSolver::FEMSolver(Grid& grid, double alpha, double ambient_temperature)
+    : grid(grid), nodes_per_element(grid.get_nodes_per_element()), block_size(nodes_per_element * nodes_per_element),
+      solver_type(SolverType::LDLT), solver_tolerance(1e-10), solver_max_iterations(1000), integration_order(16), thread_count(1), assembly_mode(AssemblyMode::Serial),
+      result_format(ResultFormat::Text), kernel_type(resolve_kernel_type(KernelType::Auto)),
+      mass_matrix(MassMatrix::Consistent), adaptive_stepping(false), step_tolerance(0.5), max_time_step(0.0),
+      write_intermediate(true), unit_operators_cached(false), checkpoint_interval(0), nonlinear_tolerance(1e-4), nonlinear_max_iterations(25),
+      reassembly_tolerance(0.01), results_directory("../Grid/results"), session_request(), session_factorizations(0) {
     calculate_local_Hbc_matrix(alpha);
 }
 
+void FEMSolver::set_solver(SolverType type, double tolerance, int max_iterations) {
+    solver_type = type;
+    solver_tolerance = tolerance;
+    solver_max_iterations = max_iterations;
+    session_solver.reset();
+}
+
+bool FEMSolver::set_integration_order(int order) {
+    if (!Integration::is_supported_order(order)) {
+        cerr << "Unsupported integration order: " << order << " (expected 2, 3, 4, 9 or 16)." << endl;
+        return false;
+    }
+    integration_order = order;
+    unit_operators_cached = false;
+    session_solver.reset();
+    return true;
+}
+
+void FEMSolver::set_thread_count(int threads) {
+#ifdef _OPENMP
+    thread_count = threads > 0 ? threads : omp_get_max_threads();
+#else
+    if (threads > 1) {
+        cerr << "OpenMP is not enabled, element kernels run on a single thread." << endl;
+    }
+    thread_count = 1;
+#endif
+}
+
+void FEMSolver::set_assembly_mode(AssemblyMode mode) {
+    assembly_mode = mode;
+}
+
+void FEMSolver::set_result_format(ResultFormat format) {
+    result_format = format;
+}
+
+void FEMSolver::set_output_options(const OutputOptions& options) {
+    output_options = options;
+}
+
+void FEMSolver::set_kernel(KernelType type) {
+    kernel_type = resolve_kernel_type(type);
+    if (type != KernelType::Auto && kernel_type != type) {
+        cerr << "The CPU does not support the " << get_kernel_name(type) << " kernel, using the scalar one." << endl;
+    }
+}
+
+KernelType FEMSolver::get_kernel() const {
+    return kernel_type;
+}
+
+void FEMSolver::set_mass_matrix(MassMatrix type) {
+    mass_matrix = type;
+    unit_operators_cached = false;
+    session_solver.reset();
+}
+
+void FEMSolver::set_write_intermediate(bool enabled) {
+    write_intermediate = enabled;
+}
+
+void FEMSolver::set_checkpoint(const string& path, int interval) {
+    checkpoint_path = path;
+    checkpoint_interval = path.empty() ? 0 : interval;
+}
+
+void FEMSolver::set_restart(const string& path) {
+    restart_path = path;
+}
+
+void FEMSolver::set_results_directory(const string& directory) {
+    results_directory = directory;
+}
+
+void FEMSolver::set_adaptive_stepping(bool enabled, double tolerance, double max_step) {
+    adaptive_stepping = enabled;
+    step_tolerance = tolerance;
+    max_time_step = max_step;
+}
+
+void FEMSolver::set_nonlinear(double tolerance, int max_iterations, double p_reassembly_tolerance) {
+    nonlinear_tolerance = tolerance;
+    nonlinear_max_iterations = max_iterations;
+    reassembly_tolerance = p_reassembly_tolerance;
+}
+
 void FEMSolver::display_matrix(vector<vector<double>>& matrix) {  
     for (const auto& row : matrix) {
         for (const auto& value : row) {
@@ -50,14 +187,24 @@ void FEMSolver::compute_jacobian(const Element& element, double xi, double eta,
          0.25 * (1 - xi)   
     };
 
-    const Node* nodes = element.get_nodes();
     fill(&J[0][0], &J[0][0] + 4, 0.0);
 
     for (int i = 0; i < 4; ++i) {
-        J[0][0] += dN_dxi[i] * nodes[i].get_x();
-        J[0][1] += dN_deta[i] * nodes[i].get_x();
-        J[1][0] += dN_dxi[i] * nodes[i].get_y();
-        J[1][1] += dN_deta[i] * nodes[i].get_y();
+        J[0][0] += dN_dxi[i] * element.get_x(i);
+        J[0][1] += dN_deta[i] * element.get_x(i);
+        J[1][0] += dN_dxi[i] * element.get_y(i);
+        J[1][1] += dN_deta[i] * element.get_y(i);
+    }
+}
+
+void FEMSolver::compute_jacobian(const Element& element, const double* dN_dxi, const double* dN_deta, double J[2][2]) const {
+    fill(&J[0][0], &J[0][0] + 4, 0.0);
+
+    for (int i = 0; i < 4; ++i) {
+        J[0][0] += dN_dxi[i] * element.get_x(i);
+        J[0][1] += dN_deta[i] * element.get_x(i);
+        J[1][0] += dN_dxi[i] * element.get_y(i);
+        J[1][1] += dN_deta[i] * element.get_y(i);
     }
 }
 
@@ -65,6 +212,8 @@ double FEMSolver::compute_jacobian_determinant(double J[2][2]) const {
     return J[0][0] * J[1][1] - J[0][1] * J[1][0];
 }
 
+// J holds dx/dxi, dx/deta in its first row, so invJ holds dxi/dx, dxi/dy in its first row and
+// dN/dx = invJ[0][0] dN/dxi + invJ[1][0] dN/deta.
 void FEMSolver::compute_inverse_jacobian(double J[2][2], double invJ[2][2]) const {
     double detJ = compute_jacobian_determinant(J);
 
@@ -101,65 +250,331 @@ double FEMSolver::calculate_H_integrand(const Element& element, double conductiv
     double invJ[2][2];
     compute_inverse_jacobian(J, invJ);
 
-    const auto& nodes = element.get_nodes();
-
     double dN_dx[4], dN_dy[4];
     for (int k = 0; k < 4; ++k) {
-        dN_dx[k] = invJ[0][0] * dN_dxi[k] + invJ[0][1] * dN_deta[k];
-        dN_dy[k] = invJ[1][0] * dN_dxi[k] + invJ[1][1] * dN_deta[k];
+        dN_dx[k] = invJ[0][0] * dN_dxi[k] + invJ[1][0] * dN_deta[k];
+        dN_dy[k] = invJ[0][1] * dN_dxi[k] + invJ[1][1] * dN_deta[k];
     }
     
     return conductivity * (dN_dx[i] * dN_dx[j] + dN_dy[i] * dN_dy[j]) * detJ;
 }
 
-void FEMSolver::calculate_Hbc_matrix(double conductivity) {
-    Integration integrator;
-    local_H_matrices.clear(); 
+void FEMSolver::compute_element_matrices(const Element& element, const UniversalElement& universal, double conductivity, double density_specific_heat, double H[16], double* C) const {
+    fill(H, H + 16, 0.0);
+    if (C != nullptr) {
+        fill(C, C + 16, 0.0);
+    }
+
+    for (int p = 0; p < universal.get_points_count(); ++p) {
+        const double* N = universal.get_N(p);
+        const double* dN_dxi = universal.get_dN_dxi(p);
+        const double* dN_deta = universal.get_dN_deta(p);
 
-    for (const auto& element : grid.get_elements()) {
-        vector<double> H(16, 0.0);  
+        double J[2][2];
+        compute_jacobian(element, dN_dxi, dN_deta, J);
+        double detJ = compute_jacobian_determinant(J);
 
-        const auto& nodes = element.get_nodes();
-        const auto& ID = element.get_ID();
+        double invJ[2][2];
+        compute_inverse_jacobian(J, invJ);
 
-        cout << "Element ID: ";
-        for (size_t i = 0; i < ID.size(); ++i) {
-            cout << ID[i] << " "; 
+        double dN_dx[4], dN_dy[4];
+        for (int k = 0; k < 4; ++k) {
+            dN_dx[k] = invJ[0][0] * dN_dxi[k] + invJ[1][0] * dN_deta[k];
+            dN_dy[k] = invJ[0][1] * dN_dxi[k] + invJ[1][1] * dN_deta[k];
         }
-        cout << endl;
 
+        double weight = universal.get_weight(p) * detJ;
         for (int i = 0; i < 4; ++i) {
             for (int j = 0; j < 4; ++j) {
-                H[i * 4 + j] = integrator.gauss_integration_2D(
-                    [this, &element, conductivity, i, j](double xi, double eta) -> double {
-                        return this->calculate_H_integrand(element, conductivity, i, j, xi, eta);
-                    }, 16, -1, 1, -1, 1);
+                H[i * 4 + j] += conductivity * (dN_dx[i] * dN_dx[j] + dN_dy[i] * dN_dy[j]) * weight;
+                if (C != nullptr) {
+                    C[i * 4 + j] += density_specific_heat * N[i] * N[j] * weight;
+                }
             }
         }
+    }
+}
 
-        cout << "-----------------------------------" << endl;
-        cout << "Macierz H bez bc:" << endl;
+template <int Order>
+void FEMSolver::compute_element_matrices(const Element& element, double conductivity, double density_specific_heat, double H[16], double* C) const {
+    const auto& table = shape_function_table<Order>;
+    double x[4], y[4];
+    for (int k = 0; k < 4; ++k) {
+        x[k] = element.get_x(k);
+        y[k] = element.get_y(k);
+    }
+
+    fill(H, H + 16, 0.0);
+    if (C != nullptr) {
+        fill(C, C + 16, 0.0);
+    }
+
+    for (int p = 0; p < table.points_count; ++p) {
+        const double* N = table.N[p];
+        const double* dN_dxi = table.dN_dxi[p];
+        const double* dN_deta = table.dN_deta[p];
+
+        double J[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } };
+        for (int k = 0; k < 4; ++k) {
+            J[0][0] += dN_dxi[k] * x[k];
+            J[0][1] += dN_deta[k] * x[k];
+            J[1][0] += dN_dxi[k] * y[k];
+            J[1][1] += dN_deta[k] * y[k];
+        }
+        double detJ = compute_jacobian_determinant(J);
+
+        double invJ[2][2];
+        compute_inverse_jacobian(J, invJ);
+
+        double dN_dx[4], dN_dy[4];
+        for (int k = 0; k < 4; ++k) {
+            dN_dx[k] = invJ[0][0] * dN_dxi[k] + invJ[1][0] * dN_deta[k];
+            dN_dy[k] = invJ[0][1] * dN_dxi[k] + invJ[1][1] * dN_deta[k];
+        }
+
+        double weight = table.weight[p] * detJ;
         for (int i = 0; i < 4; ++i) {
             for (int j = 0; j < 4; ++j) {
-                cout << H[i * 4 + j] << " ";
+                H[i * 4 + j] += conductivity * (dN_dx[i] * dN_dx[j] + dN_dy[i] * dN_dy[j]) * weight;
+                if (C != nullptr) {
+                    C[i * 4 + j] += density_specific_heat * N[i] * N[j] * weight;
+                }
+            }
+        }
+    }
+}
+
+template <ElementType Type>
+void FEMSolver::compute_element_matrices(const Element& element, double conductivity, double density_specific_heat, double* H, double* C) const {
+    constexpr int n = ElementTraits<Type>::nodes;
+    const auto& table = element_shape_table<Type>;
+    double x[n], y[n];
+    for (int k = 0; k < n; ++k) {
+        x[k] = element.get_x(k);
+        y[k] = element.get_y(k);
+    }
+
+    fill(H, H + n * n, 0.0);
+    if (C != nullptr) {
+        fill(C, C + n * n, 0.0);
+    }
+
+    for (int p = 0; p < table.points_count; ++p) {
+        const double* N = table.N[p];
+        const double* dN_dxi = table.dN_dxi[p];
+        const double* dN_deta = table.dN_deta[p];
+
+        double J[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } };
+        for (int k = 0; k < n; ++k) {
+            J[0][0] += dN_dxi[k] * x[k];
+            J[0][1] += dN_deta[k] * x[k];
+            J[1][0] += dN_dxi[k] * y[k];
+            J[1][1] += dN_deta[k] * y[k];
+        }
+        double detJ = compute_jacobian_determinant(J);
+
+        double invJ[2][2];
+        compute_inverse_jacobian(J, invJ);
+
+        // Triangles and distorted elements have a non-diagonal J, see compute_inverse_jacobian.
+        double dN_dx[n], dN_dy[n];
+        for (int k = 0; k < n; ++k) {
+            dN_dx[k] = invJ[0][0] * dN_dxi[k] + invJ[1][0] * dN_deta[k];
+            dN_dy[k] = invJ[0][1] * dN_dxi[k] + invJ[1][1] * dN_deta[k];
+        }
+
+        double weight = table.weight[p] * detJ;
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                H[i * n + j] += conductivity * (dN_dx[i] * dN_dx[j] + dN_dy[i] * dN_dy[j]) * weight;
+                if (C != nullptr) {
+                    C[i * n + j] += density_specific_heat * N[i] * N[j] * weight;
+                }
+            }
+        }
+    }
+}
+
+// The 4-node element integrates with the configured order; the other types use their own rule.
+void FEMSolver::compute_element_matrices(const Element& element, double conductivity, double density_specific_heat, double* H, double* C) const {
+    switch (grid.get_element_type()) {
+        case ElementType::Quad8:
+            compute_element_matrices<ElementType::Quad8>(element, conductivity, density_specific_heat, H, C);
+            return;
+        case ElementType::Quad9:
+            compute_element_matrices<ElementType::Quad9>(element, conductivity, density_specific_heat, H, C);
+            return;
+        case ElementType::Tri3:
+            compute_element_matrices<ElementType::Tri3>(element, conductivity, density_specific_heat, H, C);
+            return;
+        default:
+            break;
+    }
+    switch (integration_order) {
+        case 2:
+            compute_element_matrices<2>(element, conductivity, density_specific_heat, H, C);
+            break;
+        case 3:
+            compute_element_matrices<3>(element, conductivity, density_specific_heat, H, C);
+            break;
+        case 4:
+            compute_element_matrices<4>(element, conductivity, density_specific_heat, H, C);
+            break;
+        case 9:
+            compute_element_matrices<9>(element, conductivity, density_specific_heat, H, C);
+            break;
+        case 16:
+            compute_element_matrices<16>(element, conductivity, density_specific_heat, H, C);
+            break;
+        default:
+            // set_integration_order accepts only the orders above.
+            throw invalid_argument("Unsupported integration order: " + to_string(integration_order));
+    }
+}
+
+void FEMSolver::compute_local_blocks(double conductivity, double density_specific_heat, bool with_C) {
+    PROFILE_SCOPE("local_matrices");
+    long elements_count = grid.get_elements_count();
+    local_H_matrices.assign(block_size * elements_count, 0.0);
+    if (with_C) {
+        local_C_matrices.assign(block_size * elements_count, 0.0);
+    }
+
+    ShapeTableView table = get_shape_table_view(integration_order);
+    const double* x = grid.get_x();
+    const double* y = grid.get_y();
+    const int32_t* connectivity = grid.get_connectivity();
+    double* H_blocks = local_H_matrices.data();
+    double* C_blocks = with_C ? local_C_matrices.data() : nullptr;
+
+    // The SIMD kernels are specialised for the 4-node element.
+    long width = grid.get_element_type() == ElementType::Quad4 ? get_kernel_batch_width(kernel_type) : 1;
+    long batches_count = (elements_count + width - 1) / width;
+    PROFILE_COUNTER("local_matrices", "flops", (with_C ? HC_flops_per_point : H_flops_per_point) * table.points_count * elements_count);
+
+    #pragma omp parallel for num_threads(thread_count) schedule(static)
+    for (long b = 0; b < batches_count; ++b) {
+        long first = b * width;
+        long last = first + width < elements_count ? first + width : elements_count;
+
+        bool batched = width > 1 && last - first == width
+            && compute_element_batch(kernel_type, table, x, y, connectivity, first, conductivity, density_specific_heat, H_blocks, C_blocks);
+
+        for (long e = first; e < last; ++e) {
+            double* H = H_blocks + block_size * e;
+            if (!batched) {
+                compute_element_matrices(grid.get_element(e), conductivity, density_specific_heat, H, with_C ? C_blocks + block_size * e : nullptr);
+            }
+
+            const double* Hbc_local = &local_Hbc_matrices[block_size * e];
+            for (int k = 0; k < block_size; ++k) {
+                H[k] += Hbc_local[k];
+            }
+        }
+    }
+}
+
+// Row-sum lumping for the linear elements. The row sums of the 8-node element are negative at
+// the corners, so the quadratic elements are lumped by diagonal scaling (HRZ): the consistent
+// diagonal scaled to keep the element's total mass.
+void FEMSolver::lump_mass_matrices() {
+    long elements_count = local_C_matrices.size() / block_size;
+    int n = nodes_per_element;
+    bool diagonal_scaling = grid.get_element_type() == ElementType::Quad8 || grid.get_element_type() == ElementType::Quad9;
+
+    #pragma omp parallel for num_threads(thread_count) schedule(static)
+    for (long e = 0; e < elements_count; ++e) {
+        double* C_local = &local_C_matrices[block_size * e];
+        if (diagonal_scaling) {
+            double total = 0.0, diagonal_sum = 0.0;
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) {
+                    total += C_local[i * n + j];
+                }
+                diagonal_sum += C_local[i * n + i];
+            }
+            for (int i = 0; i < n; ++i) {
+                double lumped = C_local[i * n + i] * total / diagonal_sum;
+                for (int j = 0; j < n; ++j) {
+                    C_local[i * n + j] = 0.0;
+                }
+                C_local[i * n + i] = lumped;
+            }
+            continue;
+        }
+        for (int i = 0; i < n; ++i) {
+            double row_sum = 0.0;
+            for (int j = 0; j < n; ++j) {
+                row_sum += C_local[i * n + j];
+                C_local[i * n + j] = 0.0;
+            }
+            C_local[i * n + i] = row_sum;
+        }
+    }
+}
+
+void FEMSolver::calculate_local_matrices(double conductivity, double density, double specific_heat) {
+    long elements_count = grid.get_elements_count();
+    compute_local_blocks(conductivity, density * specific_heat, true);
+    if (mass_matrix == MassMatrix::Lumped) {
+        lump_mass_matrices();
+    }
+
+    if (!Logger::enabled(LogLevel::Debug)) {
+        return;
+    }
+
+    for (long e = 0; e < elements_count; ++e) {
+        const double* H = &local_H_matrices[block_size * e];
+        const double* C = &local_C_matrices[block_size * e];
+
+        grid.get_element(e).display_ID();
+        cout << "Local H matrix with Hbc:" << endl;
+        for (int i = 0; i < nodes_per_element; ++i) {
+            for (int j = 0; j < nodes_per_element; ++j) {
+                cout << H[i * nodes_per_element + j] << " ";
+            }
+            cout << endl;
+        }
+        cout << "Local C matrix for element:" << endl;
+        for (int i = 0; i < nodes_per_element; ++i) {
+            for (int j = 0; j < nodes_per_element; ++j) {
+                cout << C[i * nodes_per_element + j] << " ";
             }
             cout << endl;
         }
         cout << endl;
+    }
+}
 
-        const auto& Hbc_local = element.get_Hbc();
-        for (int i = 0; i < 4; ++i) {
-            for (int j = 0; j < 4; ++j) {
-                H[i * 4 + j] += Hbc_local[i][j];  
+void FEMSolver::calculate_Hbc_matrix(double conductivity) {
+    long elements_count = grid.get_elements_count();
+    compute_local_blocks(conductivity, 0.0, false);
+
+    if (!Logger::enabled(LogLevel::Debug)) {
+        return;
+    }
+
+    for (long e = 0; e < elements_count; ++e) {
+        const double* H = &local_H_matrices[block_size * e];
+        const double* Hbc_local = &local_Hbc_matrices[block_size * e];
+
+        grid.get_element(e).display_ID();
+
+        cout << "-----------------------------------" << endl;
+        cout << "Macierz H bez bc:" << endl;
+        for (int i = 0; i < nodes_per_element; ++i) {
+            for (int j = 0; j < nodes_per_element; ++j) {
+                cout << H[i * nodes_per_element + j] - Hbc_local[i * nodes_per_element + j] << " ";
             }
+            cout << endl;
         }
-
-        local_H_matrices.push_back(H); 
+        cout << endl;
 
         cout << "Local H matrix with Hbc:" << endl;
-        for (int i = 0; i < 4; ++i) {
-            for (int j = 0; j < 4; ++j) {
-                cout << H[i * 4 + j] << " ";
+        for (int i = 0; i < nodes_per_element; ++i) {
+            for (int j = 0; j < nodes_per_element; ++j) {
+                cout << H[i * nodes_per_element + j] << " ";
             }
             cout << endl;
         }
@@ -167,62 +582,185 @@ void FEMSolver::calculate_Hbc_matrix(double conductivity) {
     }
 }
 
-void FEMSolver::aggregate_Hbc_matrix(vector<vector<double>>& H_global, int nodes_num) const {
-    H_global.assign(nodes_num, vector<double>(nodes_num, 0.0));  
-    const auto& elements = grid.get_elements();
+void FEMSolver::assemble_matrix(const vector<double>& local_matrices, SparseMatrix& global) const {
+    PROFILE_SCOPE("assembly");
+    PROFILE_COUNTER("assembly", "nnz", global.nnz());
+    long elements_count = grid.get_elements_count();
 
-    for (size_t elem_idx = 0; elem_idx < elements.size(); ++elem_idx) {
-        const auto& element = elements[elem_idx];
-        const auto& H_local = local_H_matrices[elem_idx];  
-        const auto& ID = element.get_ID();  
+    if (assembly_mode == AssemblyMode::Serial || thread_count == 1) {
+        for (long elem_idx = 0; elem_idx < elements_count; ++elem_idx) {
+            const double* local = &local_matrices[block_size * elem_idx];
+            const int32_t* ID = grid.get_element_nodes(elem_idx);
 
-        for (int i = 0; i < 4; ++i) {
-            for (int j = 0; j < 4; ++j) {
-                if (ID[i] < nodes_num && ID[j] < nodes_num) {
-                    H_global[ID[i]][ID[j]] += H_local[i * 4 + j];
-                } else {
-                    cerr << "Invalid global index: " << ID[i] << " or " << ID[j] << endl;
+            for (int i = 0; i < nodes_per_element; ++i) {
+                for (int j = 0; j < nodes_per_element; ++j) {
+                    global.add(ID[i], ID[j], local[i * nodes_per_element + j]);
+                }
+            }
+        }
+    } else if (assembly_mode == AssemblyMode::Colored) {
+        for (const auto& color : grid.get_element_colors()) {
+            long color_size = color.size();
+
+            #pragma omp parallel for num_threads(thread_count) schedule(static)
+            for (long c = 0; c < color_size; ++c) {
+                int elem_idx = color[c];
+                const double* local = &local_matrices[block_size * elem_idx];
+                const int32_t* ID = grid.get_element_nodes(elem_idx);
+
+                for (int i = 0; i < nodes_per_element; ++i) {
+                    for (int j = 0; j < nodes_per_element; ++j) {
+                        global.add(ID[i], ID[j], local[i * nodes_per_element + j]);
+                    }
+                }
+            }
+        }
+    } else {
+        long nnz = global.nnz();
+        reset_thread_buffers(nnz);
+        auto& values = global.get_values();
+
+        #pragma omp parallel num_threads(thread_count)
+        {
+            int thread_id = 0;
+#ifdef _OPENMP
+            thread_id = omp_get_thread_num();
+#endif
+            auto& buffer = thread_buffers[thread_id];
+
+            #pragma omp for schedule(static)
+            for (long elem_idx = 0; elem_idx < elements_count; ++elem_idx) {
+                const double* local = &local_matrices[block_size * elem_idx];
+                const int32_t* ID = grid.get_element_nodes(elem_idx);
+
+                for (int i = 0; i < nodes_per_element; ++i) {
+                    for (int j = 0; j < nodes_per_element; ++j) {
+                        int k = global.find(ID[i], ID[j]);
+                        if (k >= 0) {
+                            buffer[k] += local[i * nodes_per_element + j];
+                        }
+                    }
+                }
+            }
+
+            #pragma omp for schedule(static)
+            for (long k = 0; k < nnz; ++k) {
+                for (int t = 0; t < thread_count; ++t) {
+                    values[k] += thread_buffers[t][k];
                 }
             }
         }
     }
+}
+
+void FEMSolver::assemble_vector(vector<double>& global) const {
+    PROFILE_SCOPE("assembly_P");
+    long elements_count = grid.get_elements_count();
+    int nodes_num = global.size();
 
-    ofstream output_file("../Grid/results/global_Hbc_matrix.txt");
-    if (output_file.is_open()) {
-        output_file << fixed << setprecision(5);
-        output_file << "Global Hbc matrix:" << endl << endl;
-        for (const auto& row : H_global) {
-            for (const auto& value : row) {
-                output_file << value << " ";
+    if (assembly_mode == AssemblyMode::Serial || thread_count == 1) {
+        for (long elem_idx = 0; elem_idx < elements_count; ++elem_idx) {
+            const double* P_local = &local_P_vectors[nodes_per_element * elem_idx]; 
+            const int32_t* ID = grid.get_element_nodes(elem_idx);   
+
+            for (int i = 0; i < nodes_per_element; ++i) {
+                if (ID[i] < nodes_num) {
+                    global[ID[i]] += P_local[i]; 
+                } else {
+                    cerr << "Invalid global index: " << ID[i] << endl;
+                }
+            }
+        }
+    } else if (assembly_mode == AssemblyMode::Colored) {
+        for (const auto& color : grid.get_element_colors()) {
+            long color_size = color.size();
+
+            #pragma omp parallel for num_threads(thread_count) schedule(static)
+            for (long c = 0; c < color_size; ++c) {
+                const double* P_local = &local_P_vectors[nodes_per_element * color[c]];
+                const int32_t* ID = grid.get_element_nodes(color[c]);
+
+                for (int i = 0; i < nodes_per_element; ++i) {
+                    global[ID[i]] += P_local[i];
+                }
             }
-            output_file << endl; 
         }
-        output_file.close(); 
     } else {
-        cerr << "Error" << endl;
+        reset_thread_buffers(nodes_num);
+
+        #pragma omp parallel num_threads(thread_count)
+        {
+            int thread_id = 0;
+#ifdef _OPENMP
+            thread_id = omp_get_thread_num();
+#endif
+            auto& buffer = thread_buffers[thread_id];
+
+            #pragma omp for schedule(static)
+            for (long elem_idx = 0; elem_idx < elements_count; ++elem_idx) {
+                const double* P_local = &local_P_vectors[nodes_per_element * elem_idx];
+                const int32_t* ID = grid.get_element_nodes(elem_idx);
+
+                for (int i = 0; i < nodes_per_element; ++i) {
+                    buffer[ID[i]] += P_local[i];
+                }
+            }
+
+            #pragma omp for schedule(static)
+            for (long node = 0; node < nodes_num; ++node) {
+                for (int t = 0; t < thread_count; ++t) {
+                    global[node] += thread_buffers[t][node];
+                }
+            }
+        }
     }
+}
 
-    cout << "-----------------------------------" << endl;
-    cout << "Global Hbc Matrix:" << endl << endl;
-    for (const auto& row : H_global) {
-        for (const auto& value : row) {
-            cout << value << " ";
+// The per-thread accumulation buffers are kept between assemblies, so only the first one
+// allocates.
+void FEMSolver::reset_thread_buffers(size_t size) const {
+    if (thread_buffers.size() < static_cast<size_t>(thread_count)) {
+        thread_buffers.resize(thread_count);
+    }
+    for (int t = 0; t < thread_count; ++t) {
+        thread_buffers[t].assign(size, 0.0);
+    }
+}
+
+void FEMSolver::aggregate_Hbc_matrix(SparseMatrix& H_global, int nodes_num) const {
+    H_global.build_pattern(grid.get_connectivity(), grid.get_elements_count(), nodes_per_element, nodes_num);
+
+    assemble_matrix(local_H_matrices, H_global);
+
+    if (write_intermediate) {
+        ofstream output_file(results_directory + "/global_Hbc_matrix.txt");
+        if (output_file.is_open()) {
+            output_file << fixed << setprecision(5);
+            output_file << "Global Hbc matrix:" << endl << endl;
+            H_global.write(output_file);
+            output_file.close(); 
+        } else {
+            cerr << "Error" << endl;
         }
-        cout << endl;
     }
+
+    if (!Logger::enabled(LogLevel::Debug)) {
+        return;
+    }
+
+    cout << "-----------------------------------" << endl;
+    cout << "Global Hbc Matrix:" << endl << endl;
+    H_global.display();
     cout << endl;
 }
 
-void FEMSolver::integrate_Hbc_on_edge(const Node& node1, const Node& node2, double alpha, vector<vector<double>>& Hbc) const {
-    Integration integrator;
-    vector<double> xi_points = integrator.get_points(4);  
-    vector<double> weights = integrator.get_weights(4); 
-
+void FEMSolver::integrate_Hbc_on_edge(const Node& node1, const Node& node2, double alpha, double Hbc[2][2]) const {
+    using Rule = GaussRule<4>;
     double L = sqrt(pow(node2.get_x() - node1.get_x(), 2) + pow(node2.get_y() - node1.get_y(), 2));
 
-    for (int k = 0; k < xi_points.size(); ++k) {
-        double xi = xi_points[k];
-        double weight = weights[k];
+    for (int k = 0; k < Rule::order; ++k) {
+        double xi = Rule::points[k];
+        double weight = Rule::weights[k];
         double N1 = 0.5 * (1 - xi);
         double N2 = 0.5 * (1 + xi);
         double detJ = L / 2;
@@ -235,34 +773,126 @@ void FEMSolver::integrate_Hbc_on_edge(const Node& node1, const Node& node2, doub
     }
 }
 
+// Convection on the boundary edges of an element of the given type: an edge is on the
+// boundary when all its nodes are. Quadratic edges are curved in general, so detJ is taken
+// from the edge's own shape functions at each of the 3 Gauss points; linear edges use 2.
+// Hbc gets alpha N_i N_j and P gets alpha T_ambient N_i, either may be null.
+template <ElementType Type>
+void FEMSolver::integrate_boundary_edges(const Element& element, double alpha, double ambient_temperature, double* Hbc, double* P) const {
+    using Traits = ElementTraits<Type>;
+    constexpr int n = Traits::nodes;
+    constexpr int m = Traits::edge_nodes;
+    using Rule = GaussRule<m == 3 ? 3 : 2>;
+
+    for (int edge = 0; edge < Traits::edges; ++edge) {
+        const int* local = Traits::edge[edge];
+        bool on_boundary = true;
+        for (int k = 0; k < m; ++k) {
+            on_boundary = on_boundary && element.get_BC(local[k]);
+        }
+        if (!on_boundary) {
+            continue;
+        }
+
+        for (int q = 0; q < Rule::order; ++q) {
+            double s = Rule::points[q];
+            double N[3], dN_ds[3];
+            if (m == 3) {
+                N[0] = element_detail::lagrange(-1, s);
+                N[1] = element_detail::lagrange(1, s);
+                N[2] = element_detail::lagrange(0, s);
+                dN_ds[0] = element_detail::lagrange_derivative(-1, s);
+                dN_ds[1] = element_detail::lagrange_derivative(1, s);
+                dN_ds[2] = element_detail::lagrange_derivative(0, s);
+            } else {
+                N[0] = 0.5 * (1 - s);
+                N[1] = 0.5 * (1 + s);
+                dN_ds[0] = -0.5;
+                dN_ds[1] = 0.5;
+            }
+            double dx_ds = 0.0, dy_ds = 0.0;
+            for (int k = 0; k < m; ++k) {
+                dx_ds += dN_ds[k] * element.get_x(local[k]);
+                dy_ds += dN_ds[k] * element.get_y(local[k]);
+            }
+            double weight = alpha * Rule::weights[q] * sqrt(dx_ds * dx_ds + dy_ds * dy_ds);
+
+            for (int i = 0; i < m; ++i) {
+                if (P != nullptr) {
+                    P[local[i]] += weight * ambient_temperature * N[i];
+                }
+                if (Hbc == nullptr) {
+                    continue;
+                }
+                for (int j = 0; j < m; ++j) {
+                    Hbc[local[i] * n + local[j]] += weight * N[i] * N[j];
+                }
+            }
+        }
+    }
+}
+
+void FEMSolver::integrate_boundary_edges(const Element& element, double alpha, double ambient_temperature, double* Hbc, double* P) const {
+    switch (grid.get_element_type()) {
+        case ElementType::Quad8:
+            integrate_boundary_edges<ElementType::Quad8>(element, alpha, ambient_temperature, Hbc, P);
+            break;
+        case ElementType::Quad9:
+            integrate_boundary_edges<ElementType::Quad9>(element, alpha, ambient_temperature, Hbc, P);
+            break;
+        case ElementType::Tri3:
+            integrate_boundary_edges<ElementType::Tri3>(element, alpha, ambient_temperature, Hbc, P);
+            break;
+        default:
+            integrate_boundary_edges<ElementType::Quad4>(element, alpha, ambient_temperature, Hbc, P);
+            break;
+    }
+}
+
 void FEMSolver::calculate_local_Hbc_matrix(double alpha) {
-    for (auto& element : grid.get_elements()) {
-        vector<vector<double>> Hbc_local(4, vector<double>(4, 0.0));
+    PROFILE_SCOPE("Hbc");
+    long elements_count = grid.get_elements_count();
+    local_Hbc_matrices.assign(block_size * elements_count, 0.0);
+    bool quad4 = grid.get_element_type() == ElementType::Quad4;
+
+    #pragma omp parallel for num_threads(thread_count) schedule(static)
+    for (long e = 0; e < elements_count; ++e) {
+        const Element element = grid.get_element(e);
+        double* Hbc_local = &local_Hbc_matrices[block_size * e];
+        if (!quad4) {
+            integrate_boundary_edges(element, alpha, 0.0, Hbc_local, nullptr);
+            continue;
+        }
 
-        const Node* nodes = element.get_nodes();
         for (int edge = 0; edge < 4; ++edge) {
-            const Node& node1 = nodes[edge];
-            const Node& node2 = nodes[(edge + 1) % 4];
+            Node node1 = element.get_node(edge);
+            Node node2 = element.get_node((edge + 1) % 4);
 
             if (node1.get_BC() && node2.get_BC()) {
-                vector<vector<double>> Hbc_edge(2, vector<double>(2, 0.0));
+                double Hbc_edge[2][2] = { { 0.0, 0.0 }, { 0.0, 0.0 } };
                 integrate_Hbc_on_edge(node1, node2, alpha, Hbc_edge);
                 int local_indices[2] = {edge, (edge + 1) % 4};
 
                 for (int i = 0; i < 2; ++i) {
                     for (int j = 0; j < 2; ++j) {
-                        Hbc_local[local_indices[i]][local_indices[j]] += Hbc_edge[i][j];
+                        Hbc_local[local_indices[i] * 4 + local_indices[j]] += Hbc_edge[i][j];
                     }
                 }
             }
         }
+    }
 
-        element.set_Hbc(Hbc_local);
+    if (!Logger::enabled(LogLevel::Debug)) {
+        return;
+    }
+
+    for (long e = 0; e < elements_count; ++e) {
+        const double* Hbc_local = &local_Hbc_matrices[block_size * e];
         cout << "Local Hbc matrix for element:" << endl;
 
-        for (const auto& row : Hbc_local) {
-            for (const auto& value : row) {
-                cout << value << " ";
+        for (int i = 0; i < nodes_per_element; ++i) {
+            for (int j = 0; j < nodes_per_element; ++j) {
+                cout << Hbc_local[i * nodes_per_element + j] << " ";
             }
             cout << endl;
         }
@@ -271,26 +901,31 @@ void FEMSolver::calculate_local_Hbc_matrix(double alpha) {
 }
 
 void FEMSolver::calculate_P_vector(double alpha, double ambient_temperature) {
-    cout << "-----------------------------------" << endl;
-    cout << "Local P vectors for elements:" << endl << endl;
-
-    for (auto& element : grid.get_elements()) {
-        vector<double> P_local(4, 0.0);
-        const Node* nodes = element.get_nodes();
+    PROFILE_SCOPE("P_vector");
+    long elements_count = grid.get_elements_count();
+    local_P_vectors.assign(nodes_per_element * elements_count, 0.0);
+    bool quad4 = grid.get_element_type() == ElementType::Quad4;
+
+    #pragma omp parallel for num_threads(thread_count) schedule(static)
+    for (long e = 0; e < elements_count; ++e) {
+        const Element element = grid.get_element(e);
+        double* P_local = &local_P_vectors[nodes_per_element * e];
+        if (!quad4) {
+            integrate_boundary_edges(element, alpha, ambient_temperature, nullptr, P_local);
+            continue;
+        }
 
         for (int edge = 0; edge < 4; ++edge) {
-            const Node& node1 = nodes[edge];
-            const Node& node2 = nodes[(edge + 1) % 4];
+            Node node1 = element.get_node(edge);
+            Node node2 = element.get_node((edge + 1) % 4);
 
             if (node1.get_BC() && node2.get_BC()) {
-                Integration integrator;
-                vector<double> xi_points = integrator.get_points(2);
-                vector<double> weights = integrator.get_weights(2);
+                using Rule = GaussRule<2>;
                 double L = sqrt(pow(node2.get_x() - node1.get_x(), 2) + pow(node2.get_y() - node1.get_y(), 2));
 
-                for (int k = 0; k < xi_points.size(); ++k) {
-                    double xi = xi_points[k];
-                    double weight = weights[k];
+                for (int k = 0; k < Rule::order; ++k) {
+                    double xi = Rule::points[k];
+                    double weight = Rule::weights[k];
                     double N1 = 0.5 * (1 - xi);
                     double N2 = 0.5 * (1 + xi);
                     double detJ = 0.5 * L; 
@@ -301,11 +936,18 @@ void FEMSolver::calculate_P_vector(double alpha, double ambient_temperature) {
                 }
             }
         }
+    }
+
+    if (!Logger::enabled(LogLevel::Debug)) {
+        return;
+    }
 
-        element.set_P(P_local);
+    cout << "-----------------------------------" << endl;
+    cout << "Local P vectors for elements:" << endl << endl;
 
-        for (const auto& value : P_local) {
-            cout << value << " ";
+    for (long e = 0; e < elements_count; ++e) {
+        for (int i = 0; i < nodes_per_element; ++i) {
+            cout << local_P_vectors[nodes_per_element * e + i] << " ";
         }
         cout << endl << endl;
     }
@@ -313,267 +955,959 @@ void FEMSolver::calculate_P_vector(double alpha, double ambient_temperature) {
 
 void FEMSolver::aggregate_P_vector(vector<double>& P_global, int nodes_num) const {
     P_global.assign(nodes_num, 0.0);  
-    const auto& elements = grid.get_elements();
+    assemble_vector(P_global);
 
-    for (const auto& element : elements) {
-        const auto& P_local = element.get_P(); 
-        const auto& ID = element.get_ID();   
+    if (Logger::enabled(LogLevel::Debug)) {
+        cout << "-----------------------------------" << endl;
+        cout << "Global P vector:" << endl << endl;
+        for (const auto& value : P_global) {
+            cout << value << " ";
+        }
+        cout << endl << endl;
+    }
 
-        for (int i = 0; i < 4; ++i) {
-            if (ID[i] < nodes_num) {
-                P_global[ID[i]] += P_local[i]; 
-            } else {
-                cerr << "Invalid global index: " << ID[i] << endl;
+    if (write_intermediate) {
+        ofstream output_file(results_directory + "/global_P_vector.txt");
+        if (output_file.is_open()) {
+            output_file << "Global P vector:" << endl << endl;
+            for (const auto& val : P_global) {
+                output_file << val << " ";
             }
+            
+            output_file.close(); 
+        } else {
+            cerr << "Error" << endl;    
         }
     }
+}
 
-    cout << "-----------------------------------" << endl;
-    cout << "Global P vector:" << endl << endl;
-    for (const auto& value : P_global) {
-        cout << value << " ";
+bool FEMSolver::solve_system(const SparseMatrix& H_global, const vector<double>& P_global, vector<double>& t_global) {
+    auto linear_solver = create_linear_solver(solver_type, solver_tolerance, solver_max_iterations);
+    vector<double> x(H_global.size(), 0.0);
+
+    PROFILE_COUNTER("factorization", "nnz", H_global.nnz());
+    bool solved = false;
+    if (factorize_profiled(*linear_solver, H_global)) {
+        PROFILE_SCOPE("solve");
+        solved = linear_solver->solve(P_global, x);
+        PROFILE_COUNTER("solve", "iterations", linear_solver->get_last_iterations());
+    }
+    if (!solved) {
+        cerr << "Error: the steady-state system could not be solved." << endl;
+        return false;
     }
-    cout << endl << endl;
 
-    ofstream output_file("../Grid/results/global_P_vector.txt");
-    if (output_file.is_open()) {
-        output_file << "Global P vector:" << endl << endl;
-        for (const auto& val : P_global) {
-            output_file << val << " ";
-        }
-        
-        output_file.close(); 
-    } else {
-        cerr << "Error" << endl;    
+    t_global = x;
+    write_t_vector(t_global);
+    return true;
+}
+
+bool FEMSolver::solve_system(const vector<double>& P_global, vector<double>& t_global) {
+    ElementOperator H_operator(grid, thread_count);
+    H_operator.add_term(local_H_matrices, 1.0);
+
+    auto linear_solver = create_matrix_free_solver();
+    vector<double> x(H_operator.size(), 0.0);
+
+    bool solved = false;
+    if (factorize_profiled(*linear_solver, H_operator)) {
+        PROFILE_SCOPE("solve");
+        solved = linear_solver->solve(P_global, x);
+        PROFILE_COUNTER("solve", "iterations", linear_solver->get_last_iterations());
     }
+    if (!solved) {
+        cerr << "Error: the steady-state system could not be solved." << endl;
+        return false;
+    }
+
+    t_global = x;
+    write_t_vector(t_global);
+    return true;
 }
 
-void FEMSolver::solve_system(vector<vector<double>>& H_global, vector<double>& P_global, vector<double>& t_global) {
-    int n = H_global.size();
-    
-    vector<vector<double>> A = H_global;  
-    vector<double> b = P_global;      
-    vector<double> x(n, 0.0);            
+unique_ptr<LinearSolver> FEMSolver::create_matrix_free_solver() const {
+    SolverType type = solver_type;
+    if (type == SolverType::LDLT || type == SolverType::Banded) {
+        type = SolverType::PCG_Jacobi;
+    }
+    return create_linear_solver(type, solver_tolerance, solver_max_iterations);
+}
 
-    for (int i = 0; i < n; i++) {
-        int max_row = i;
-        for (int k = i + 1; k < n; k++) {
-            if (abs(A[k][i]) > abs(A[max_row][i])) {
-                max_row = k;
+void FEMSolver::write_t_vector(const vector<double>& t_solver) const {
+    vector<double> t_global;
+    grid.to_original_order(t_solver, t_global);
+    if (Logger::enabled(LogLevel::Debug)) {
+        cout << "-----------------------------------" << endl;
+        cout << "Global t vector:" << endl << endl;
+        for (const auto& temp : t_global) {
+            cout << temp << " ";
+        }
+        cout << endl << endl;
+    }
+
+    if (write_intermediate) {
+        ofstream output_file(results_directory + "/global_t_vector.txt");
+        if (output_file.is_open()) {
+            output_file << "Global t vector:" << endl << endl;
+            for (const auto& val : t_global) {
+                output_file << val << " ";
             }
+            
+            output_file.close(); 
+        } else {
+            cerr << "Error" << endl;    
+        }
+    }
+}
+
+void FEMSolver::calculate_C_matrix(double density, double specific_heat) {
+    PROFILE_SCOPE("C_matrix");
+    const auto& table = shape_function_table<4>;
+    long elements_count = grid.get_elements_count();
+    local_C_matrices.assign(block_size * elements_count, 0.0);
+    bool quad4 = grid.get_element_type() == ElementType::Quad4;
+
+    #pragma omp parallel for num_threads(thread_count) schedule(static)
+    for (long e = 0; e < elements_count; ++e) {
+        const Element element = grid.get_element(e);
+        double* C_local = &local_C_matrices[block_size * e];
+        if (!quad4) {
+            double H[max_element_nodes * max_element_nodes];
+            compute_element_matrices(element, 0.0, density * specific_heat, H, C_local);
+            continue;
         }
 
-        if (abs(A[max_row][i]) < 1e-12) {
-            cerr << ("The matrix is singular, the system cannot be solved.") << endl;
+        for (int p = 0; p < table.points_count; ++p) {
+            const double* N = table.N[p];
+
+            double J[2][2];
+            compute_jacobian(element, table.dN_dxi[p], table.dN_deta[p], J);
+            double detJ = compute_jacobian_determinant(J);
+            double weight = table.weight[p];
+
+            for (int k = 0; k < 4; ++k) {
+                for (int l = 0; l < 4; ++l) {
+                    C_local[k * 4 + l] += density * specific_heat * N[k] * N[l] * detJ * weight;
+                }
+            }
         }
+    }
+    if (mass_matrix == MassMatrix::Lumped) {
+        lump_mass_matrices();
+    }
 
-        swap(A[i], A[max_row]);
-        swap(b[i], b[max_row]);
+    if (!Logger::enabled(LogLevel::Debug)) {
+        return;
+    }
 
-        for (int j = i + 1; j < n; j++) {
-            double factor = A[j][i] / A[i][i];
-            for (int k = i; k < n; k++) {
-                A[j][k] -= factor * A[i][k];
+    for (long e = 0; e < elements_count; ++e) {
+        const double* C_local = &local_C_matrices[block_size * e];
+        cout << "Local C matrix for element:" << endl;
+        for (int i = 0; i < nodes_per_element; ++i) {
+            for (int j = 0; j < nodes_per_element; ++j) {
+                cout << C_local[i * nodes_per_element + j] << " ";
             }
-            b[j] -= factor * b[i];
+            cout << endl;
         }
+        cout << endl;
     }
+}
 
-    for (int i = n - 1; i >= 0; i--) {
-        x[i] = b[i];
-        for (int j = i + 1; j < n; j++) {
-            x[i] -= A[i][j] * x[j];
+void FEMSolver::aggregate_C_matrix(SparseMatrix& C_global, int nodes_num) const {
+    C_global.build_pattern(grid.get_connectivity(), grid.get_elements_count(), nodes_per_element, nodes_num);
+
+    assemble_matrix(local_C_matrices, C_global);
+
+    if (write_intermediate) {
+        ofstream output_file(results_directory + "/global_C_matrix.txt");
+        if (output_file.is_open()) {
+            output_file << fixed << setprecision(5);
+            output_file << "Global C matrix:" << endl << endl;
+            C_global.write(output_file);
+            output_file.close();
+        } else {
+            cerr << "Error opening file for global C matrix." << endl;
         }
-        x[i] /= A[i][i];
     }
 
-    t_global = x;
+    if (!Logger::enabled(LogLevel::Debug)) {
+        return;
+    }
 
     cout << "-----------------------------------" << endl;
-    cout << "Global t vector:" << endl << endl;
-    for (const auto& temp : t_global) {
-        cout << temp << " ";
-    }
-    cout << endl << endl;
+    cout << "Global C Matrix:" << endl;
+    C_global.display();
+    cout << endl;
+}
 
-    ofstream output_file("../Grid/results/global_t_vector.txt");
-    if (output_file.is_open()) {
-        output_file << "Global t vector:" << endl << endl;
-        for (const auto& val : t_global) {
-            output_file << val << " ";
+bool FEMSolver::simulate_time(const SparseMatrix& H_global, const SparseMatrix& C_global, const vector<double>& P_global, vector<double>& t_initial, double time_step, double total_time) {
+    auto build_system = [&](double dt) {
+        auto A = make_unique<SparseMatrix>(C_global);
+        A->scale(1.0 / dt);
+        A->add_scaled(H_global, 1.0);
+
+        if (Logger::enabled(LogLevel::Debug)) {
+            cout << "-----------------------------------" << endl;
+            cout << "Matrix [H] + [C]/dT:" << endl;
+            A->display();
         }
-        
-        output_file.close(); 
-    } else {
-        cerr << "Error" << endl;    
+
+        auto system = make_unique<TimeStepSystem>();
+        system->solver = create_linear_solver(solver_type, solver_tolerance, solver_max_iterations);
+        PROFILE_COUNTER("factorization", "nnz", A->nnz());
+        if (!factorize_profiled(*system->solver, *A)) {
+            return unique_ptr<TimeStepSystem>();
+        }
+        system->A = move(A);
+        return system;
+    };
+
+    cout << fixed << setprecision(5);
+    if (Logger::enabled(LogLevel::Info)) {
+        cout << "Linear solver: " << create_linear_solver(solver_type)->name() << endl;
+    }
+
+    if (adaptive_stepping) {
+        return run_adaptive_steps(C_global, build_system, P_global, t_initial, time_step, total_time);
     }
+
+    auto system = build_system(time_step);
+    if (!system) {
+        return false;
+    }
+    return !run_time_steps(*system->solver, C_global, P_global, t_initial, time_step, total_time).empty();
 }
 
-void FEMSolver::calculate_C_matrix(double density, double specific_heat) {
-    Integration integrator;
-    local_C_matrices.clear(); 
-
-    int order = 4; 
-    vector<double> gauss_points = integrator.get_points(order);
-    vector<double> gauss_weights = integrator.get_weights(order);
-
-    for (const auto& element : grid.get_elements()) {
-        vector<double> C_local(16, 0.0);  
-
-        const auto& nodes = element.get_nodes();
-
-        for (int i = 0; i < order; ++i) { 
-            for (int j = 0; j < order; ++j) { 
-                double xi = gauss_points[i];
-                double eta = gauss_points[j];
-                double weight = gauss_weights[i] * gauss_weights[j]; 
-
-                double N[4] = {
-                    0.25 * (1 - xi) * (1 - eta),
-                    0.25 * (1 + xi) * (1 - eta),
-                    0.25 * (1 + xi) * (1 + eta),
-                    0.25 * (1 - xi) * (1 + eta)
-                };
-
-                double J[2][2];
-                compute_jacobian(element, xi, eta, J);
-                double detJ = compute_jacobian_determinant(J);
-
-                for (int k = 0; k < 4; ++k) {
-                    for (int l = 0; l < 4; ++l) {
-                        C_local[k * 4 + l] += density * specific_heat * N[k] * N[l] * detJ * weight;
-                    }
-                }
-            }
+bool FEMSolver::simulate_time(const vector<double>& P_global, vector<double>& t_initial, double time_step, double total_time) {
+    auto build_system = [&](double dt) {
+        auto A = make_unique<ElementOperator>(grid, thread_count);
+        A->add_term(local_C_matrices, 1.0 / dt);
+        A->add_term(local_H_matrices, 1.0);
+
+        auto system = make_unique<TimeStepSystem>();
+        system->solver = create_matrix_free_solver();
+        if (!factorize_profiled(*system->solver, *A)) {
+            return unique_ptr<TimeStepSystem>();
         }
+        system->A = move(A);
+        return system;
+    };
 
-        local_C_matrices.push_back(C_local);
+    ElementOperator C_operator(grid, thread_count);
+    C_operator.add_term(local_C_matrices, 1.0);
 
-        cout << "Local C matrix for element:" << endl;
-        for (int i = 0; i < 4; ++i) {
-            for (int j = 0; j < 4; ++j) {
-                cout << C_local[i * 4 + j] << " ";
+    cout << fixed << setprecision(5);
+    if (Logger::enabled(LogLevel::Info)) {
+        cout << "Linear solver: " << create_matrix_free_solver()->name() << " (matrix-free)" << endl;
+    }
+
+    if (adaptive_stepping) {
+        return run_adaptive_steps(C_operator, build_system, P_global, t_initial, time_step, total_time);
+    }
+
+    auto system = build_system(time_step);
+    if (!system) {
+        return false;
+    }
+    return !run_time_steps(*system->solver, C_operator, P_global, t_initial, time_step, total_time).empty();
+}
+
+vector<double> FEMSolver::run_time_steps(LinearSolver& linear_solver, const LinearOperator& C_global, const vector<double>& P_global,
+                                         const vector<double>& t_initial, double time_step, double total_time) {
+    int num_nodes = C_global.size();
+    vector<double> t_next(num_nodes, 0.0);
+    vector<double> b(num_nodes, 0.0);
+
+    ResultWriter writer;
+    CheckpointState state;
+    if (!begin_run(writer, t_initial, time_step, true, state)) {
+        return vector<double>();
+    }
+    vector<double> t_current = state.t_current;
+
+    int steps_count = count_time_steps(time_step, total_time);
+    for (int step = state.step + 1; step <= steps_count; ++step) {
+        PROFILE_SCOPE("time_step");
+        double time = step * time_step;
+        C_global.apply(t_current, b);
+        for (int i = 0; i < num_nodes; ++i) {
+            b[i] = P_global[i] + b[i] / time_step;
+        }
+
+        if (Logger::enabled(LogLevel::Debug)) {
+            cout << "Vector P ([{P} + {[C]/dT}*{T0}]) at time: " << time << " s" << endl;
+            for (const auto& value : b) {
+                cout << value << " ";
             }
             cout << endl;
         }
-        cout << endl;
+
+        t_next = t_current;
+        if (!linear_solver.solve(b, t_next)) {
+            cerr << "Error: the linear solve failed at time " << time << " s, the run was stopped." << endl;
+            writer.close();
+            return vector<double>();
+        }
+        PROFILE_COUNTER("time_step", "iterations", linear_solver.get_last_iterations());
+        write_time_step(writer, time, t_next);
+        t_current = t_next;
+        save_checkpoint(writer, step, time, time_step, 0.0, t_current, t_current);
     }
+    writer.close();
+    return t_current;
 }
 
-void FEMSolver::aggregate_C_matrix(vector<vector<double>>& C_global, int nodes_num) const {
-    C_global.assign(nodes_num, vector<double>(nodes_num, 0.0));
-    const auto& elements = grid.get_elements();
-
-    for (size_t elem_idx = 0; elem_idx < elements.size(); ++elem_idx) {
-        const auto& element = elements[elem_idx];
-        const auto& C_local = local_C_matrices[elem_idx];
-        const auto& ID = element.get_ID();  
+bool FEMSolver::run_adaptive_steps(const LinearOperator& C_global, const function<unique_ptr<TimeStepSystem>(double)>& build_system,
+                                   const vector<double>& P_global, const vector<double>& t_initial, double time_step, double total_time) {
+    const size_t max_cached_systems = 8;
+    int num_nodes = C_global.size();
+    double min_step = time_step / 1024.0;
+    double max_step = max_time_step > 0.0 ? max_time_step : total_time;
+
+    // dt only moves on the ladder time_step * 2^k, so factorizations are reused whenever
+    // the controller comes back to a step size it has already used.
+    auto quantize = [&](double dt) {
+        double level = time_step * pow(2.0, floor(log2(dt / time_step) + 1e-9));
+        return min(max(level, min_step), max_step);
+    };
 
-        for (int i = 0; i < 4; ++i) {
-            for (int j = 0; j < 4; ++j) {
-                if (ID[i] < nodes_num && ID[j] < nodes_num) {
-                    C_global[ID[i]][ID[j]] += C_local[i * 4 + j];
-                } else {
-                    cerr << "Invalid global index: " << ID[i] << " or " << ID[j] << endl;
+    map<double, unique_ptr<TimeStepSystem>> systems;
+    int factorizations = 0;
+    auto get_system = [&](double dt) -> TimeStepSystem* {
+        auto it = systems.find(dt);
+        if (it != systems.end()) {
+            return it->second.get();
+        }
+        if (systems.size() >= max_cached_systems) {
+            auto farthest = systems.begin();
+            for (auto candidate = systems.begin(); candidate != systems.end(); ++candidate) {
+                if (abs(log(candidate->first / dt)) > abs(log(farthest->first / dt))) {
+                    farthest = candidate;
                 }
             }
+            systems.erase(farthest);
         }
+        auto system = build_system(dt);
+        if (!system) {
+            return nullptr;
+        }
+        ++factorizations;
+        return (systems[dt] = move(system)).get();
+    };
+
+    vector<double> t_next(num_nodes, 0.0);
+    vector<double> b(num_nodes, 0.0);
+
+    ResultWriter writer;
+    CheckpointState state;
+    if (!begin_run(writer, t_initial, time_step, false, state)) {
+        return false;
     }
+    vector<double> t_current = state.t_current;
+    vector<double> t_previous = state.t_previous;
+
+    double time = state.time;
+    double dt = quantize(state.time_step);
+    double previous_step = state.previous_step;
+    int accepted = state.step, rejected = 0;
+
+    while (total_time - time > 1e-9 * total_time) {
+        PROFILE_SCOPE("time_step");
+        double step = min(dt, total_time - time);
+        TimeStepSystem* system = get_system(step);
+        if (system == nullptr) {
+            writer.close();
+            return false;
+        }
+
+        C_global.apply(t_current, b);
+        for (int i = 0; i < num_nodes; ++i) {
+            b[i] = P_global[i] + b[i] / step;
+        }
+        t_next = t_current;
+        if (!system->solver->solve(b, t_next)) {
+            cerr << "Error: the linear solve failed at time " << time + step << " s, the run was stopped." << endl;
+            writer.close();
+            return false;
+        }
+        PROFILE_COUNTER("time_step", "iterations", system->solver->get_last_iterations());
+
+        // Backward Euler against a linear extrapolation of the last two states: their
+        // difference estimates the local error, no second solve is needed.
+        double error = 0.0;
+        if (previous_step > 0.0) {
+            double ratio = step / previous_step;
+            for (int i = 0; i < num_nodes; ++i) {
+                double predicted = t_current[i] + ratio * (t_current[i] - t_previous[i]);
+                error = max(error, abs(t_next[i] - predicted));
+            }
+            error *= step / (step + previous_step);
+        }
 
-    ofstream output_file("../Grid/results/global_C_matrix.txt");
-    if (output_file.is_open()) {
-        output_file << fixed << setprecision(5);
-        output_file << "Global C matrix:" << endl << endl;
-        for (const auto& row : C_global) {
-            for (const auto& value : row) {
-                output_file << value << " ";
+        if (error > step_tolerance && step > min_step) {
+            ++rejected;
+            PROFILE_COUNTER("time_step", "rejected", 1);
+            dt = quantize(step * max(0.2, 0.9 * sqrt(step_tolerance / error)));
+            if (dt >= step) {
+                dt = quantize(step / 2.0);
             }
-            output_file << endl;
+            continue;
         }
-        output_file.close();
-    } else {
-        cerr << "Error opening file for global C matrix." << endl;
+
+        time += step;
+        ++accepted;
+        t_previous.swap(t_current);
+        t_current.swap(t_next);
+        previous_step = step;
+        write_time_step(writer, time, t_current);
+
+        double growth = error > 0.0 ? min(2.0, 0.9 * sqrt(step_tolerance / error)) : 2.0;
+        dt = quantize(max(dt, step) * growth);
+        save_checkpoint(writer, accepted, time, dt, previous_step, t_current, t_previous);
     }
+    writer.close();
 
-    cout << "-----------------------------------" << endl;
-    cout << "Global C Matrix:" << endl;
-    for (const auto& row : C_global) {
-        for (const auto& value : row) {
-            cout << value << " ";
+    if (Logger::enabled(LogLevel::Info)) {
+        cout << "Adaptive time stepping: " << accepted << " accepted, " << rejected << " rejected steps, "
+             << factorizations << " factorizations" << endl;
+    }
+    return true;
+}
+
+// Local conductance K (without convection) and capacity blocks for unit k and rho c, lumped
+// with the lumped mass; the current local blocks are put back afterwards.
+void FEMSolver::compute_unit_blocks(vector<double>& K_blocks, vector<double>& C_blocks) {
+    long elements_count = grid.get_elements_count();
+    vector<double> H_saved, C_saved, Hbc_saved;
+    H_saved.swap(local_H_matrices);
+    C_saved.swap(local_C_matrices);
+    Hbc_saved.swap(local_Hbc_matrices);
+
+    local_Hbc_matrices.assign(block_size * elements_count, 0.0);
+    compute_local_blocks(1.0, 1.0, true);
+    if (mass_matrix == MassMatrix::Lumped) {
+        lump_mass_matrices();
+    }
+    K_blocks.swap(local_H_matrices);
+    C_blocks.swap(local_C_matrices);
+
+    local_H_matrices.swap(H_saved);
+    local_C_matrices.swap(C_saved);
+    local_Hbc_matrices.swap(Hbc_saved);
+}
+
+void FEMSolver::cache_unit_operators() {
+    PROFILE_SCOPE("unit_operators");
+    int num_nodes = grid.get_nodes_count();
+    long elements_count = grid.get_elements_count();
+
+    vector<double> K_blocks, C_blocks;
+    compute_unit_blocks(K_blocks, C_blocks);
+
+    // The unit Hbc and P are computed in the local buffers, the current ones are put back
+    // afterwards.
+    vector<double> Hbc_saved, P_saved;
+    Hbc_saved.swap(local_Hbc_matrices);
+    P_saved.swap(local_P_vectors);
+    calculate_local_Hbc_matrix(1.0);
+    calculate_P_vector(1.0, 1.0);
+
+    K_unit.build_pattern(grid.get_connectivity(), elements_count, nodes_per_element, num_nodes);
+    Hbc_unit = K_unit;
+    C_unit = K_unit;
+    assemble_matrix(K_blocks, K_unit);
+    assemble_matrix(local_Hbc_matrices, Hbc_unit);
+    assemble_matrix(C_blocks, C_unit);
+    P_unit.assign(num_nodes, 0.0);
+    assemble_vector(P_unit);
+
+    local_Hbc_matrices.swap(Hbc_saved);
+    local_P_vectors.swap(P_saved);
+    unit_operators_cached = true;
+}
+
+void FEMSolver::combine_operators(double conductivity, double density_specific_heat, double alpha, double ambient_temperature,
+                                  SparseMatrix& H_global, SparseMatrix& C_global, vector<double>& P_global) {
+    if (!unit_operators_cached) {
+        cache_unit_operators();
+    }
+
+    PROFILE_SCOPE("combine_operators");
+    PROFILE_COUNTER("combine_operators", "nnz", K_unit.nnz());
+    H_global = K_unit;
+    H_global.scale(conductivity);
+    H_global.add_scaled(Hbc_unit, alpha);
+    C_global = C_unit;
+    C_global.scale(density_specific_heat);
+
+    P_global.resize(P_unit.size());
+    for (size_t i = 0; i < P_unit.size(); ++i) {
+        P_global[i] = alpha * ambient_temperature * P_unit[i];
+    }
+}
+
+bool FEMSolver::solve(const SolveRequest& request, vector<double>& t_final) {
+    PROFILE_SCOPE("session_solve");
+    combine_operators(request.conductivity, request.density_specific_heat, request.alpha, request.ambient_temperature, session_H, session_C,
+                      session_P);
+
+    bool same_system = session_solver && request.conductivity == session_request.conductivity
+                       && request.density_specific_heat == session_request.density_specific_heat && request.alpha == session_request.alpha
+                       && request.time_step == session_request.time_step;
+    if (!same_system) {
+        session_A = session_C;
+        session_A.scale(1.0 / request.time_step);
+        session_A.add_scaled(session_H, 1.0);
+        session_solver = create_linear_solver(solver_type, solver_tolerance, solver_max_iterations);
+        PROFILE_COUNTER("factorization", "nnz", session_A.nnz());
+        ++session_factorizations;
+        if (!factorize_profiled(*session_solver, session_A)) {
+            session_solver.reset();
+            return false;
         }
-        cout << endl;
+        session_request = request;
     }
-    cout << endl;
+
+    cout << fixed << setprecision(5);
+    vector<double> t_initial(grid.get_nodes_count(), request.initial_temperature);
+    vector<double> t_solver = run_time_steps(*session_solver, session_C, session_P, t_initial, request.time_step, request.total_time);
+    if (t_solver.empty()) {
+        return false;
+    }
+    grid.to_original_order(t_solver, t_final);
+    return true;
 }
 
-void FEMSolver::simulate_time(vector<vector<double>>& H_global, vector<vector<double>>& C_global, vector<double>& P_global, vector<double>& t_initial, double time_step, double total_time) {
-    int num_nodes = H_global.size();
-    vector<double> t_current = t_initial; 
-    vector<double> t_next(num_nodes, 0.0);
-    vector<vector<double>> A(num_nodes, vector<double>(num_nodes, 0.0));
-    vector<double> b(num_nodes, 0.0);
+int FEMSolver::get_session_factorizations() const {
+    return session_factorizations;
+}
 
-    ofstream output_file("../Grid/results/simulation_temperatures.txt");
-    if (!output_file.is_open()) {
-        cerr << "Error opening file for writing results." << endl;
-        return;
+bool FEMSolver::simulate_scenarios(const vector<Scenario>& scenarios, double conductivity, double density, double specific_heat, double time_step, double total_time) {
+    map<double, vector<int>> groups;
+    for (size_t s = 0; s < scenarios.size(); ++s) {
+        groups[scenarios[s].alfa].push_back(s);
     }
-    output_file << fixed << setprecision(5); 
-    output_file << "Simulation results:\n\n";
 
-    for (double time = 50.0; time <= total_time; time += time_step) {
-        output_file << "Time: " << time << " s\n";
+    int num_nodes = grid.get_nodes_count();
+    int steps_count = count_time_steps(time_step, total_time);
+    cout << fixed << setprecision(5);
+
+    for (const auto& group : groups) {
+        double alpha = group.first;
+        const vector<int>& members = group.second;
+        int rhs_count = members.size();
+
+        SparseMatrix H_global, C_global;
+        vector<double> P_alpha;
+        combine_operators(conductivity, density * specific_heat, alpha, 1.0, H_global, C_global, P_alpha);
+
+        SparseMatrix A = C_global;
+        A.scale(1.0 / time_step);
+        A.add_scaled(H_global, 1.0);
+        auto linear_solver = create_linear_solver(solver_type, solver_tolerance, solver_max_iterations);
+        PROFILE_COUNTER("factorization", "nnz", A.nnz());
+        if (!factorize_profiled(*linear_solver, A)) {
+            return false;
+        }
 
+        vector<double> P_block(static_cast<size_t>(num_nodes) * rhs_count);
+        vector<double> T_block(static_cast<size_t>(num_nodes) * rhs_count);
+        vector<double> B_block, CT_block;
         for (int i = 0; i < num_nodes; ++i) {
-            for (int j = 0; j < num_nodes; ++j) {
-                A[i][j] = C_global[i][j] / time_step + H_global[i][j];
+            for (int k = 0; k < rhs_count; ++k) {
+                const Scenario& scenario = scenarios[members[k]];
+                P_block[static_cast<size_t>(i) * rhs_count + k] = scenario.ambient_temp * P_alpha[i];
+                T_block[static_cast<size_t>(i) * rhs_count + k] = scenario.initial_temp;
             }
         }
 
-        cout << "-----------------------------------" << endl;
-        cout << "Matrix [H] + [C]/dT at time: " << time << " s" << endl;
-        for (const auto& row : A) {
-            for (const auto& value : row) {
-                cout << fixed << setprecision(5) << value << " ";
+        vector<unique_ptr<ResultWriter>> writers(rhs_count);
+        for (int k = 0; k < rhs_count; ++k) {
+            writers[k] = make_unique<ResultWriter>();
+            if (!open_results(*writers[k], num_nodes, time_step, "scenario_" + to_string(members[k]) + "_temperatures")) {
+                return false;
             }
-            cout << endl;
         }
 
-        for (int i = 0; i < num_nodes; ++i) {
-            b[i] = P_global[i];
-            for (int j = 0; j < num_nodes; ++j) {
-                b[i] += C_global[i][j] * t_current[j] / time_step;
+        if (Logger::enabled(LogLevel::Info)) {
+            cout << "Alfa " << alpha << ": " << rhs_count << " scenario(s) against one " << linear_solver->name() << " factorization" << endl;
+        }
+
+        vector<double> frame(num_nodes);
+        for (int step = 1; step <= steps_count; ++step) {
+            PROFILE_SCOPE("time_step");
+            C_global.multiply_block(T_block, CT_block, rhs_count);
+            B_block.resize(CT_block.size());
+            for (size_t i = 0; i < CT_block.size(); ++i) {
+                B_block[i] = P_block[i] + CT_block[i] / time_step;
+            }
+            if (!linear_solver->solve_block(B_block, T_block, rhs_count)) {
+                cerr << "Error: the linear solve failed at time " << step * time_step << " s, the sweep was stopped." << endl;
+                for (auto& writer : writers) {
+                    writer->close();
+                }
+                return false;
+            }
+            PROFILE_COUNTER("time_step", "iterations", linear_solver->get_last_iterations());
+
+            for (int k = 0; k < rhs_count; ++k) {
+                for (int i = 0; i < num_nodes; ++i) {
+                    frame[i] = T_block[static_cast<size_t>(i) * rhs_count + k];
+                }
+                writers[k]->write_frame(step * time_step, frame);
             }
         }
 
-        cout << "Vector P ([{P} + {[C]/dT}*{T0}]) at time: " << time << " s" << endl;
-        for (const auto& value : b) {
-            cout << fixed << setprecision(5) << value << " ";
+        for (int k = 0; k < rhs_count; ++k) {
+            writers[k]->close();
+            if (Logger::enabled(LogLevel::Info)) {
+                double min_temp = T_block[k], max_temp = T_block[k];
+                for (int i = 0; i < num_nodes; ++i) {
+                    min_temp = min(min_temp, T_block[static_cast<size_t>(i) * rhs_count + k]);
+                    max_temp = max(max_temp, T_block[static_cast<size_t>(i) * rhs_count + k]);
+                }
+                cout << "Scenario " << members[k] << " (alfa " << alpha << ", ambient " << scenarios[members[k]].ambient_temp
+                     << ", initial " << scenarios[members[k]].initial_temp << "): minimum " << min_temp << ", maximum " << max_temp << endl;
+            }
         }
-        cout << endl;
+    }
+    return true;
+}
 
-        solve_system(A, b, t_next);
+bool FEMSolver::simulate_time_nonlinear(const Material& material, const vector<double>& P_global, vector<double>& t_initial, double time_step,
+                                        double total_time) {
+    int num_nodes = grid.get_nodes_count();
+    long elements_count = grid.get_elements_count();
+    int n = nodes_per_element;
+
+    vector<double> K_blocks, C_blocks;
+    compute_unit_blocks(K_blocks, C_blocks);
+
+    SparseMatrix H_global, C_global, A;
+    H_global.build_pattern(grid.get_connectivity(), elements_count, n, num_nodes);
+    C_global = H_global;
+    assemble_matrix(local_Hbc_matrices, H_global);
+
+    // Every element keeps the properties of the mean temperature they were evaluated at. It is
+    // re-evaluated, and the change of k K_e and rho c C_e added to the global matrices, only
+    // once its mean temperature has moved by more than the reassembly tolerance.
+    vector<double> element_conductivity(elements_count, 0.0), element_capacity(elements_count, 0.0);
+    vector<double> evaluated_at(elements_count, 0.0);
+    bool all_elements = true;
+    auto update_elements = [&](const vector<double>& t) {
+        PROFILE_SCOPE("nonlinear_update");
+        long updated = 0;
+        for (long e = 0; e < elements_count; ++e) {
+            const int32_t* ID = grid.get_element_nodes(e);
+            double mean = 0.0;
+            for (int i = 0; i < n; ++i) {
+                mean += t[ID[i]];
+            }
+            mean /= n;
+            if (!all_elements && abs(mean - evaluated_at[e]) <= reassembly_tolerance) {
+                continue;
+            }
+
+            double conductivity = material.conductivity.evaluate(mean);
+            double capacity = material.get_capacity(mean);
+            double conductivity_change = conductivity - element_conductivity[e];
+            double capacity_change = capacity - element_capacity[e];
+            const double* K_local = &K_blocks[block_size * e];
+            const double* C_local = &C_blocks[block_size * e];
+            for (int i = 0; i < n; ++i) {
+                for (int j = 0; j < n; ++j) {
+                    H_global.add(ID[i], ID[j], conductivity_change * K_local[i * n + j]);
+                    C_global.add(ID[i], ID[j], capacity_change * C_local[i * n + j]);
+                }
+            }
+            element_conductivity[e] = conductivity;
+            element_capacity[e] = capacity;
+            evaluated_at[e] = mean;
+            ++updated;
+        }
+        all_elements = false;
+        return updated;
+    };
+
+    auto linear_solver = create_linear_solver(solver_type, solver_tolerance, solver_max_iterations);
+    int factorizations = 0;
+    auto refactorize = [&]() {
+        A = C_global;
+        A.scale(1.0 / time_step);
+        A.add_scaled(H_global, 1.0);
+        ++factorizations;
+        PROFILE_COUNTER("factorization", "nnz", A.nnz());
+        return factorize_profiled(*linear_solver, A);
+    };
 
+    cout << fixed << setprecision(5);
+    if (Logger::enabled(LogLevel::Info)) {
+        cout << "Linear solver: " << linear_solver->name() << " (nonlinear, lagged factorization)" << endl;
+    }
+
+    ResultWriter writer;
+    CheckpointState state;
+    if (!begin_run(writer, t_initial, time_step, true, state)) {
+        return false;
+    }
+    vector<double> t_current = state.t_current;
+    vector<double> t_iterate, change(num_nodes), residual(num_nodes), delta(num_nodes), Ht, Cdt;
+    long element_updates = update_elements(t_current);
+    long iterations = 0;
+    int unconverged_steps = 0;
+    bool stale = true;
+
+    // Each step solves C(T) (T - T_n) / dt + H(T) T = P by iterating with the last factorized
+    // C / dt + H: residual r = P - H T - C (T - T_n) / dt, correction A_lagged dT = r. The
+    // factorization is renewed only when the corrections stop shrinking fast enough.
+    int steps_count = count_time_steps(time_step, total_time);
+    for (int step = state.step + 1; step <= steps_count; ++step) {
+        PROFILE_SCOPE("time_step");
+        double time = step * time_step;
+        t_iterate = t_current;
+        double previous_correction = 0.0;
+        bool converged = false;
+
+        for (int iteration = 1; iteration <= nonlinear_max_iterations && !converged; ++iteration) {
+            if (iteration > 1) {
+                element_updates += update_elements(t_iterate);
+            }
+            if (stale) {
+                if (!refactorize()) {
+                    writer.close();
+                    return false;
+                }
+                stale = false;
+            }
+
+            H_global.multiply(t_iterate, Ht);
+            for (int i = 0; i < num_nodes; ++i) {
+                change[i] = t_iterate[i] - t_current[i];
+            }
+            C_global.multiply(change, Cdt);
+            for (int i = 0; i < num_nodes; ++i) {
+                residual[i] = P_global[i] - Ht[i] - Cdt[i] / time_step;
+            }
+
+            fill(delta.begin(), delta.end(), 0.0);
+            if (!linear_solver->solve(residual, delta)) {
+                cerr << "Error: the linear solve failed at time " << time << " s, the run was stopped." << endl;
+                writer.close();
+                return false;
+            }
+            double correction = 0.0;
+            for (int i = 0; i < num_nodes; ++i) {
+                t_iterate[i] += delta[i];
+                correction = max(correction, abs(delta[i]));
+            }
+            ++iterations;
+
+            converged = correction <= nonlinear_tolerance;
+            if (iteration > 1 && correction > lagged_convergence_rate * previous_correction) {
+                stale = true;
+            }
+            previous_correction = correction;
+        }
+        if (!converged) {
+            ++unconverged_steps;
+            stale = true;
+        }
+
+        write_time_step(writer, time, t_iterate);
+        t_current = t_iterate;
+        element_updates += update_elements(t_current);
+        save_checkpoint(writer, step, time, time_step, 0.0, t_current, t_current);
+    }
+    writer.close();
+
+    if (unconverged_steps > 0) {
+        cerr << "Warning: " << unconverged_steps << " time step(s) did not converge within " << nonlinear_max_iterations
+             << " nonlinear iterations." << endl;
+    }
+    if (Logger::enabled(LogLevel::Info)) {
+        cout << "Nonlinear stepping: " << iterations << " iterations, " << factorizations << " factorizations, "
+             << element_updates << " element updates" << endl;
+    }
+    return true;
+}
+
+int FEMSolver::count_time_steps(double time_step, double total_time) {
+    return static_cast<int>(floor(total_time / time_step + 1e-9));
+}
+
+string FEMSolver::get_results_path(const string& name) const {
+    return results_directory + "/" + name + (result_format == ResultFormat::Binary ? ".bin" : ".txt");
+}
+
+bool FEMSolver::open_results(ResultWriter& writer, int num_nodes, double time_step, const string& name) const {
+    writer.set_node_order(grid.get_node_permutation());
+    writer.set_options(output_options);
+    return writer.open(get_results_path(name), result_format, num_nodes, time_step);
+}
+
+// Opens the results and sets up the initial state, or the state of the restart checkpoint.
+// A restart is used once: later runs of this solver start from t_initial again.
+bool FEMSolver::begin_run(ResultWriter& writer, const vector<double>& t_initial, double time_step, bool fixed_step, CheckpointState& state) {
+    int num_nodes = t_initial.size();
+    state = { 0, 0.0, time_step, 0.0, 0, 0, t_initial, t_initial };
+    if (restart_path.empty()) {
+        return open_results(writer, num_nodes, time_step);
+    }
+
+    string path = restart_path;
+    restart_path.clear();
+    CheckpointState saved;
+    if (!Checkpoint::read(path, num_nodes, saved)) {
+        return false;
+    }
+    if (fixed_step && abs(saved.time_step - time_step) > 1e-12 * time_step) {
+        cerr << "Error: checkpoint " << path << " was written with time step " << saved.time_step << ", not " << time_step << "." << endl;
+        return false;
+    }
+
+    state.step = saved.step;
+    state.time = saved.time;
+    state.time_step = saved.time_step;
+    state.previous_step = saved.previous_step;
+    grid.from_original_order(saved.t_current, state.t_current);
+    grid.from_original_order(saved.t_previous, state.t_previous);
+
+    writer.set_node_order(grid.get_node_permutation());
+    writer.set_options(output_options);
+    if (!writer.resume(get_results_path("simulation_temperatures"), result_format, num_nodes, saved.results_offset, saved.frames_written)) {
+        return false;
+    }
+    writer.restore_schedule(state.step, state.time);
+    if (Logger::enabled(LogLevel::Info)) {
+        cout << "Restarting from " << path << " at step " << state.step << ", time " << state.time << " s" << endl;
+    }
+    return true;
+}
+
+void FEMSolver::save_checkpoint(ResultWriter& writer, int64_t step, double time, double time_step, double previous_step,
+                                const vector<double>& t_current, const vector<double>& t_previous) const {
+    if (checkpoint_interval <= 0 || step % checkpoint_interval != 0) {
+        return;
+    }
+    PROFILE_SCOPE("checkpoint");
+    CheckpointState state = { step, time, time_step, previous_step, 0, 0, {}, {} };
+    state.results_offset = writer.flush();
+    state.frames_written = writer.get_frames_written();
+    grid.to_original_order(t_current, state.t_current);
+    grid.to_original_order(t_previous, state.t_previous);
+    Checkpoint::write(checkpoint_path, state);
+}
+
+// Writes the frame of a step and logs it; the field statistics are computed once for both.
+void FEMSolver::write_time_step(ResultWriter& writer, double time, const vector<double>& temperatures) const {
+    if (!Logger::enabled(LogLevel::Info)) {
+        writer.write_frame(time, temperatures);
+        return;
+    }
+    FieldStats stats = compute_field_stats(temperatures);
+    writer.write_frame(time, temperatures, stats);
+
+    if (Logger::enabled(LogLevel::Debug)) {
         cout << "Temperatures:" << endl;
-        for (const auto& temp : t_next) {
+        for (const auto& temp : temperatures) {
             cout << temp << " ";
         }
         cout << endl;
+    }
+    cout << "Time: " << time << " s" << endl;
+    cout << "Minimum Temperature: " << stats.min << endl;
+    cout << "Maximum Temperature: " << stats.max << endl;
+}
+
+double FEMSolver::compute_stable_time_step(vector<double>& lumped_mass) const {
+    int num_nodes = grid.get_nodes_count();
+    long elements_count = grid.get_elements_count();
+    vector<double> H_row_bound(num_nodes, 0.0);
+    lumped_mass.assign(num_nodes, 0.0);
+
+    for (long e = 0; e < elements_count; ++e) {
+        const int32_t* ID = grid.get_element_nodes(e);
+        const double* H_local = &local_H_matrices[block_size * e];
+        const double* C_local = &local_C_matrices[block_size * e];
+
+        for (int i = 0; i < nodes_per_element; ++i) {
+            for (int j = 0; j < nodes_per_element; ++j) {
+                H_row_bound[ID[i]] += abs(H_local[i * nodes_per_element + j]);
+                lumped_mass[ID[i]] += C_local[i * nodes_per_element + j];
+            }
+        }
+    }
 
-        output_file << "Temperatures: ";
-        for (const auto& temp : t_next) {
-            output_file << temp << " ";
+    // Forward Euler is stable for dt < 2 / lambda_max(M^-1 H); the Gershgorin row bound
+    // of the element contributions gives a safe upper bound on lambda_max.
+    double lambda_max = 0.0;
+    for (int i = 0; i < num_nodes; ++i) {
+        if (lumped_mass[i] <= 0.0) {
+            cerr << "Error: non-positive lumped mass at node " << i << "." << endl;
+            return 0.0;
         }
-        output_file << "\n";
+        lambda_max = max(lambda_max, H_row_bound[i] / lumped_mass[i]);
+    }
+    return lambda_max > 0.0 ? 2.0 / lambda_max : numeric_limits<double>::infinity();
+}
 
-        double min_temp = *min_element(t_next.begin(), t_next.end());
-        double max_temp = *max_element(t_next.begin(), t_next.end());
-        cout << "Minimum Temperature: " << min_temp << endl;
-        cout << "Maximum Temperature: " << max_temp << endl;
+bool FEMSolver::simulate_time_explicit(const SparseMatrix& H_global, const vector<double>& P_global, vector<double>& t_initial, double time_step, double total_time) {
+    return run_explicit_steps(H_global, P_global, t_initial, time_step, total_time);
+}
 
-        output_file << "Minimum Temperature: " << min_temp << "\n";
-        output_file << "Maximum Temperature: " << max_temp << "\n\n";
-        t_current = t_next;
+bool FEMSolver::simulate_time_explicit(const vector<double>& P_global, vector<double>& t_initial, double time_step, double total_time) {
+    ElementOperator H_operator(grid, thread_count);
+    H_operator.add_term(local_H_matrices, 1.0);
+    return run_explicit_steps(H_operator, P_global, t_initial, time_step, total_time);
+}
+
+bool FEMSolver::run_explicit_steps(const LinearOperator& H_global, const vector<double>& P_global, const vector<double>& t_initial, double time_step, double total_time) {
+    int num_nodes = H_global.size();
+    vector<double> lumped_mass;
+    double stable_step = compute_stable_time_step(lumped_mass);
+    if (stable_step <= 0.0) {
+        return false;
+    }
+
+    int substeps = max(1, static_cast<int>(ceil(time_step / stable_step)));
+    double substep = time_step / substeps;
+
+    cout << fixed << setprecision(5);
+    if (Logger::enabled(LogLevel::Info)) {
+        cout << "Explicit Euler: stable time step " << stable_step << " s, " << substeps << " substep(s) of " << substep << " s per time step" << endl;
+    }
+
+    vector<double> inv_mass(num_nodes);
+    for (int i = 0; i < num_nodes; ++i) {
+        inv_mass[i] = substep / lumped_mass[i];
+    }
+
+    vector<double> Ht(num_nodes, 0.0);
+
+    ResultWriter writer;
+    CheckpointState state;
+    if (!begin_run(writer, t_initial, time_step, true, state)) {
+        return false;
     }
-    output_file.close();
-}
\ No newline at end of file
+    vector<double> t_current = state.t_current;
+
+    int steps_count = count_time_steps(time_step, total_time);
+    for (int step = state.step + 1; step <= steps_count; ++step) {
+        PROFILE_SCOPE("time_step");
+        PROFILE_COUNTER("time_step", "substeps", substeps);
+        double time = step * time_step;
+        for (int s = 0; s < substeps; ++s) {
+            H_global.apply(t_current, Ht);
+
+            #pragma omp parallel for num_threads(thread_count) schedule(static)
+            for (int i = 0; i < num_nodes; ++i) {
+                t_current[i] += inv_mass[i] * (P_global[i] - Ht[i]);
+            }
+        }
+
+        write_time_step(writer, time, t_current);
+        save_checkpoint(writer, step, time, time_step, 0.0, t_current, t_current);
+    }
+    writer.close();
+    return true;
+}
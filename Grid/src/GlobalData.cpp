@@ -1,71 +1,49 @@
 #include <math.h>
 #include <fstream>
-#include <sstream>
 #include <iostream>
-#include <vector>
+#include <sstream>
 #include <stdexcept>
+#include <vector>
 #include "GlobalData.h"
-#include "Node.h" 
-#include "Element.h"
 
 using std::cout;
 using std::cerr;
 using std::endl;
 using std::string;
-using std::istringstream;
 using std::ifstream;
-using std::vector;
 using std::runtime_error;
+using std::istringstream;
+using std::vector;
 
-vector<Node> GlobalData::nodes_xy;
-
-void GlobalData::read_file() {
+bool GlobalData::read_file(const string& data_directory) {
+    GlobalData read;
     try {
-        ifstream data_file("../Grid/data/data.txt");
+        ifstream data_file(data_directory + "/data.txt");
         if (!data_file.is_open()) {
             throw runtime_error("File: data.txt not found.");
         }
 
-        if (!(data_file >> simulation_time >> simulation_step_time >> conductivity >> alfa >> ambient_temp
-                       >> initial_temp >> density >> specific_heat >> nN >> nE >> nH >> nW >> H >> W)) {
+        if (!(data_file >> read.simulation_time >> read.simulation_step_time >> read.conductivity >> read.alfa >> read.ambient_temp
+                       >> read.initial_temp >> read.density >> read.specific_heat >> read.nN >> read.nE >> read.nH >> read.nW >> read.H >> read.W)) {
             throw runtime_error("Error reading data from file: data.txt");
         }
 
-        if (simulation_time < 0) {
+        if (read.simulation_time < 0) {
             throw runtime_error("Simulation time cannot be negative.");
         }
 
-        if (simulation_step_time <= 0 || conductivity <= 0 || alfa <= 0 || density <= 0 || specific_heat <= 0 
-                || nN <= 0 || nE <= 0 || nH <= 0 || nW <= 0 || H <= 0 || W <= 0) {
+        if (read.simulation_step_time <= 0 || read.conductivity <= 0 || read.alfa <= 0 || read.density <= 0 || read.specific_heat <= 0 
+                || read.nN <= 0 || read.nE <= 0 || read.nH <= 0 || read.nW <= 0 || read.H <= 0 || read.W <= 0) {
             throw runtime_error("Simulation data must be positive.");
         }
 
         data_file.close();
-
-        ifstream xy_nodes_file("../Grid/data/xy_nodes.txt");
-        if (!xy_nodes_file.is_open()) {
-            throw runtime_error("File: xy_nodes.txt not found.");
-        }
-
-        string line;
-        while (getline(xy_nodes_file, line)) {
-            double x, y;
-            int BC;
-            if (!(istringstream(line) >> x >> y >> BC)) {
-                cout << x << y << BC;
-                throw runtime_error("Failed to read line: " + line);
-            }
-            nodes_xy.emplace_back(x, y, BC);
-        }
-        xy_nodes_file.close();
-
-        if (nodes_xy.empty()) {
-            cerr << "Error: No nodes were loaded from xy_nodes.txt" << endl;
-        }
-
     } catch (const runtime_error& e) {
         cerr << "Error: " << e.what() << endl;
+        return false;
     }
+    *this = read;
+    return true;
 }
 
 double GlobalData::get_simulation_time() { return simulation_time; }
@@ -82,7 +60,6 @@ double GlobalData::get_nH() { return nH; }
 double GlobalData::get_nW() { return nW; }
 double GlobalData::get_height() { return H; }
 double GlobalData::get_width() { return W; }
-const vector<Node>& GlobalData::get_nodes() { return nodes_xy; }
 
 void GlobalData::display_simulation_data() {
     cout << "-----------------------------------" << endl;
@@ -98,4 +75,82 @@ void GlobalData::display_simulation_data() {
     cout << "Number of nodes: " << nN << endl;
     cout << "Number of elements: " << nE << endl;
     cout << "-----------------------------------" << endl;
-}
\ No newline at end of file
+}
+
+bool GlobalData::read_scenarios(const string& path, vector<Scenario>& scenarios) {
+    ifstream scenarios_file(path);
+    if (!scenarios_file.is_open()) {
+        cerr << "Error: File: " << path << " not found." << endl;
+        return false;
+    }
+
+    scenarios.clear();
+    string line;
+    while (getline(scenarios_file, line)) {
+        if (line.find_first_not_of(" \t\r") == string::npos || line[0] == '#') {
+            continue;
+        }
+
+        Scenario scenario;
+        if (!(istringstream(line) >> scenario.alfa >> scenario.ambient_temp >> scenario.initial_temp) || scenario.alfa <= 0) {
+            cerr << "Error: Failed to read scenario: " << line << endl;
+            return false;
+        }
+        scenarios.push_back(scenario);
+    }
+
+    if (scenarios.empty()) {
+        cerr << "Error: No scenarios were loaded from " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+bool GlobalData::read_material(const string& path, Material& material) {
+    ifstream material_file(path);
+    if (!material_file.is_open()) {
+        cerr << "Error: File: " << path << " not found." << endl;
+        return false;
+    }
+
+    const string names[3] = { "conductivity", "density", "specific_heat" };
+    vector<double> temperatures[3], values[3];
+    string line;
+    while (getline(material_file, line)) {
+        if (line.find_first_not_of(" \t\r") == string::npos || line[0] == '#') {
+            continue;
+        }
+
+        string name;
+        double temperature, value;
+        int property = 0;
+        istringstream fields(line);
+        if (fields >> name) {
+            while (property < 3 && names[property] != name) {
+                ++property;
+            }
+        }
+        if (property == 3 || !(fields >> temperature >> value) || value <= 0
+            || (!temperatures[property].empty() && temperature <= temperatures[property].back())) {
+            cerr << "Error: Failed to read material point (temperatures must increase, values be positive): " << line << endl;
+            return false;
+        }
+        temperatures[property].push_back(temperature);
+        values[property].push_back(value);
+    }
+
+    MaterialProperty* properties[3] = { &material.conductivity, &material.density, &material.specific_heat };
+    for (int property = 0; property < 3; ++property) {
+        if (values[property].size() == 1) {
+            cerr << "Error: " << names[property] << " in " << path << " has a single point, a table needs at least two"
+                 << " (constant values are set in data.txt)." << endl;
+            return false;
+        }
+    }
+    for (int property = 0; property < 3; ++property) {
+        if (!values[property].empty()) {
+            *properties[property] = MaterialProperty::from_table(temperatures[property], values[property]);
+        }
+    }
+    return true;
+}
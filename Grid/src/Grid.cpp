@@ -1,37 +1,184 @@
 #include "Grid.h"
+#include "MeshLoader.h"
+#include <algorithm>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <utility>
 #include <vector>
-#include <math.h>
 
 using std::endl;
 using std::cout;
 using std::cerr;
 using std::vector;
+using std::string;
+using std::sort;
+using std::unique;
+using std::max;
+using std::abs;
+using std::make_pair;
+using std::move;
 
-Grid::Grid() {}
+Grid::Grid()
+    : x(nullptr), y(nullptr), bc(nullptr), connectivity(nullptr), nodes_count(0), elements_count(0), element_type(ElementType::Quad4),
+      nodes_per_element(4) {}
 
-Grid::Grid(double p_nN, double p_nE, double p_nW, double p_nH, double p_height, double p_width) : nN(p_nN), nE(p_nE), nW(p_nW), nH(p_nH), height(p_height), width(p_width) {
+Grid::Grid(double p_nN, double p_nE, double p_nW, double p_nH, double p_height, double p_width, MeshSource source, const string& mesh_path,
+           ElementType type)
+    : nN(p_nN), nE(p_nE), nW(p_nW), nH(p_nH), height(p_height), width(p_width), x(nullptr), y(nullptr), bc(nullptr), connectivity(nullptr),
+      nodes_count(0), elements_count(0) {
+    set_element_type(type);
+    bool quadratic = type == ElementType::Quad8 || type == ElementType::Quad9;
+    if (source == MeshSource::Generated) {
+        generate_nodes();
+    } else if (MeshLoader::is_binary_mesh(mesh_path)) {
+        if (load_binary_mesh(mesh_path) && type != ElementType::Quad4 && type != element_type) {
+            cerr << "Warning: " << mesh_path << " holds " << get_element_type_name(element_type) << " elements, not "
+                 << get_element_type_name(type) << "." << endl;
+        }
+        return;
+    } else if (quadratic) {
+        cerr << "Error: " << get_element_type_name(type) << " elements need a generated or binary mesh, " << mesh_path
+             << " only lists the nW x nH corner nodes." << endl;
+        return;
+    } else if (!load_text_nodes(mesh_path)) {
+        return;
+    }
     create_elements();
 }
 
-vector<Node> Grid::nodes_xy;
+Grid::Grid(vector<double> p_x, vector<double> p_y, vector<int32_t> p_bc, vector<int32_t> p_connectivity, ElementType type)
+    : nN(p_x.size()), nE(p_connectivity.size() / get_element_nodes_count(type)), nW(0), nH(0), height(0), width(0), x_storage(move(p_x)),
+      y_storage(move(p_y)), bc_storage(move(p_bc)), connectivity_storage(move(p_connectivity)), x(nullptr), y(nullptr), bc(nullptr),
+      connectivity(nullptr), nodes_count(0), elements_count(0) {
+    set_element_type(type);
+    bind_storage();
+}
 
-vector<Element>& Grid::get_elements() {
-     return elements; 
+void Grid::set_element_type(ElementType type) {
+    element_type = type;
+    nodes_per_element = get_element_nodes_count(type);
 }
 
-void Grid::create_elements() {
-    nodes_xy = GlobalData::get_nodes();  
-    size_t nodes_num = nodes_xy.size();
+void Grid::bind_storage() {
+    mapped_mesh.reset();
+    x = x_storage.data();
+    y = y_storage.data();
+    bc = bc_storage.data();
+    connectivity = connectivity_storage.data();
+    nodes_count = x_storage.size();
+    elements_count = connectivity_storage.size() / nodes_per_element;
+}
 
-    if (nodes_num != nN) {  
+int Grid::get_nodes_count() const { return nodes_count; }
+int Grid::get_elements_count() const { return elements_count; }
+ElementType Grid::get_element_type() const { return element_type; }
+int Grid::get_nodes_per_element() const { return nodes_per_element; }
+
+Element Grid::get_element(int element) const {
+    return Element(&connectivity[static_cast<size_t>(nodes_per_element) * element], x, y, bc, nodes_per_element);
+}
+
+const int32_t* Grid::get_element_nodes(int element) const { return &connectivity[static_cast<size_t>(nodes_per_element) * element]; }
+const double* Grid::get_x() const { return x; }
+const double* Grid::get_y() const { return y; }
+const int32_t* Grid::get_bc() const { return bc; }
+const int32_t* Grid::get_connectivity() const { return connectivity; }
+
+bool Grid::load_text_nodes(const string& path) {
+    if (!MeshLoader::load_text_nodes(path, nN, x_storage, y_storage, bc_storage)) {
+        return false;
+    }
+
+    size_t nodes_num = x_storage.size();
+    if (nodes_num != nN || nodes_num != nW * nH) {  
         cerr << "Wrong number of nodes." << endl;
+        return false;
+    }
+    bind_storage();
+    return true;
+}
+
+bool Grid::load_binary_mesh(const string& path) {
+    BinaryMeshView view;
+    shared_ptr<MappedFile> file = MeshLoader::map_binary_mesh(path, view);
+    if (!file) {
+        return false;
+    }
+
+    x_storage.clear();
+    y_storage.clear();
+    bc_storage.clear();
+    connectivity_storage.clear();
+    set_element_type(view.element_type);
+    mapped_mesh = file;
+    x = view.x;
+    y = view.y;
+    bc = view.bc;
+    connectivity = view.connectivity;
+    nodes_count = view.nodes_count;
+    elements_count = view.elements_count;
+    nN = nodes_count;
+    nE = elements_count;
+    element_colors.clear();
+    return true;
+}
+
+bool Grid::write_binary_mesh(const string& path) const {
+    BinaryMeshView view = { nodes_count, elements_count, element_type, x, y, bc, connectivity };
+    return MeshLoader::write_binary_mesh(path, view);
+}
+
+void Grid::generate_nodes() {
+    int nodes_per_row = nW;
+    int nodes_per_col = nH;
+
+    if (element_type == ElementType::Quad8 || element_type == ElementType::Quad9) {
+        generate_quadratic_nodes();
         return;
     }
+    // nN and nE in the input describe the 4-node mesh, the element counts of other types follow from nW x nH.
+    if (element_type == ElementType::Tri3) {
+        nN = nW * nH;
+        nE = 2 * (nW - 1) * (nH - 1);
+    } else if (nN != nW * nH || nE != (nW - 1) * (nH - 1)) {
+        cerr << "Warning: nN and nE do not match nW x nH, using the generated " << nodes_per_row * nodes_per_col << " nodes." << endl;
+        nN = nW * nH;
+        nE = (nW - 1) * (nH - 1);
+    }
+
+    size_t nodes_num = static_cast<size_t>(nodes_per_row) * nodes_per_col;
+    x_storage.resize(nodes_num);
+    y_storage.resize(nodes_num);
+    bc_storage.resize(nodes_num);
+
+    double dx = width / (nodes_per_row - 1);
+    double dy = height / (nodes_per_col - 1);
+    for (int i = 0; i < nodes_per_col; ++i) {
+        for (int j = 0; j < nodes_per_row; ++j) {
+            size_t node = static_cast<size_t>(i) * nodes_per_row + j;
+            x_storage[node] = j * dx;
+            y_storage[node] = i * dy;
+            bc_storage[node] = (i == 0 || j == 0 || i == nodes_per_col - 1 || j == nodes_per_row - 1) ? 1 : 0;
+        }
+    }
+}
+
+void Grid::create_elements() {
+    int nodes_per_row = nW; 
+    int nodes_per_col = nH;  
 
-    int nodes_per_row = sqrt(nN); 
-    int nodes_per_col = nN / nodes_per_row;  
+    if (element_type == ElementType::Quad8 || element_type == ElementType::Quad9) {
+        create_quadratic_elements();
+        return;
+    }
+    if (element_type == ElementType::Tri3) {
+        create_triangles();
+        return;
+    }
 
+    connectivity_storage.clear();
+    connectivity_storage.reserve(4 * static_cast<size_t>(nodes_per_row - 1) * (nodes_per_col - 1));
     for (int i = 0; i < nodes_per_col - 1; ++i) {
         for (int j = 0; j < nodes_per_row - 1; ++j) {
             int node_1 = i * nodes_per_row + j;   
@@ -39,23 +186,312 @@ void Grid::create_elements() {
             int node_3 = node_1 + nodes_per_row + 1;   
             int node_4 = node_1 + nodes_per_row;     
 
-            Element new_element(nodes_xy[node_1], nodes_xy[node_2], nodes_xy[node_3], nodes_xy[node_4]);
-            new_element.set_ID(node_1, node_2, node_3, node_4);  
+            connectivity_storage.push_back(node_1);
+            connectivity_storage.push_back(node_2);
+            connectivity_storage.push_back(node_3);
+            connectivity_storage.push_back(node_4);
+        }
+    }
+    bind_storage();
+    element_colors.clear();
+}
+
+// Node of the (2 nW - 1) x (2 nH - 1) lattice of a generated quadratic mesh at row i and
+// column j; Quad8 has no nodes at the cell centres (odd i and j).
+static int lattice_node(ElementType type, int lattice_row, int i, int j) {
+    if (type == ElementType::Quad9) {
+        return i * lattice_row + j;
+    }
+    int corner_row = (lattice_row + 1) / 2;
+    int base = (i / 2) * (lattice_row + corner_row);
+    return i % 2 == 0 ? base + j : base + lattice_row + j / 2;
+}
+
+void Grid::generate_quadratic_nodes() {
+    int lattice_row = 2 * static_cast<int>(nW) - 1;
+    int lattice_col = 2 * static_cast<int>(nH) - 1;
+    nE = (nW - 1) * (nH - 1);
+    nN = static_cast<double>(lattice_row) * lattice_col - (element_type == ElementType::Quad8 ? nE : 0);
+
+    size_t nodes_num = static_cast<size_t>(nN);
+    x_storage.resize(nodes_num);
+    y_storage.resize(nodes_num);
+    bc_storage.resize(nodes_num);
+
+    double dx = width / (lattice_row - 1);
+    double dy = height / (lattice_col - 1);
+    for (int i = 0; i < lattice_col; ++i) {
+        for (int j = 0; j < lattice_row; ++j) {
+            if (element_type == ElementType::Quad8 && i % 2 == 1 && j % 2 == 1) {
+                continue;
+            }
+            size_t node = lattice_node(element_type, lattice_row, i, j);
+            x_storage[node] = j * dx;
+            y_storage[node] = i * dy;
+            bc_storage[node] = (i == 0 || j == 0 || i == lattice_col - 1 || j == lattice_row - 1) ? 1 : 0;
+        }
+    }
+}
+
+void Grid::create_quadratic_elements() {
+    int lattice_row = 2 * static_cast<int>(nW) - 1;
+    int cells_per_row = nW - 1;
+    int cells_per_col = nH - 1;
+
+    connectivity_storage.clear();
+    connectivity_storage.reserve(nodes_per_element * static_cast<size_t>(cells_per_row) * cells_per_col);
+    for (int ci = 0; ci < cells_per_col; ++ci) {
+        for (int cj = 0; cj < cells_per_row; ++cj) {
+            int i = 2 * ci, j = 2 * cj;
+            // Corners counter-clockwise, then the mid-side nodes of edges 0-1, 1-2, 2-3, 3-0 and the centre.
+            const int local[9][2] = { { i, j }, { i, j + 2 }, { i + 2, j + 2 }, { i + 2, j },
+                                      { i, j + 1 }, { i + 1, j + 2 }, { i + 2, j + 1 }, { i + 1, j }, { i + 1, j + 1 } };
+            for (int k = 0; k < nodes_per_element; ++k) {
+                connectivity_storage.push_back(lattice_node(element_type, lattice_row, local[k][0], local[k][1]));
+            }
+        }
+    }
+    bind_storage();
+    element_colors.clear();
+}
+
+void Grid::create_triangles() {
+    int nodes_per_row = nW;
+    int nodes_per_col = nH;
+
+    connectivity_storage.clear();
+    connectivity_storage.reserve(6 * static_cast<size_t>(nodes_per_row - 1) * (nodes_per_col - 1));
+    for (int i = 0; i < nodes_per_col - 1; ++i) {
+        for (int j = 0; j < nodes_per_row - 1; ++j) {
+            int node_1 = i * nodes_per_row + j;
+            int node_2 = node_1 + 1;
+            int node_3 = node_1 + nodes_per_row + 1;
+            int node_4 = node_1 + nodes_per_row;
+
+            // A diagonal between two boundary nodes would be taken for a boundary edge, so the
+            // corner cells where that happens are split along the other diagonal.
+            if (bc_storage[node_1] && bc_storage[node_3]) {
+                connectivity_storage.insert(connectivity_storage.end(), { node_1, node_2, node_4, node_2, node_3, node_4 });
+            } else {
+                connectivity_storage.insert(connectivity_storage.end(), { node_1, node_2, node_3, node_1, node_3, node_4 });
+            }
+        }
+    }
+    bind_storage();
+    element_colors.clear();
+}
+
+void Grid::take_ownership() {
+    if (!mapped_mesh) {
+        return;
+    }
+    x_storage.assign(x, x + nodes_count);
+    y_storage.assign(y, y + nodes_count);
+    bc_storage.assign(bc, bc + nodes_count);
+    connectivity_storage.assign(connectivity, connectivity + nodes_per_element * static_cast<size_t>(elements_count));
+    bind_storage();
+}
+
+void Grid::reorder_nodes() {
+    if (nodes_count == 0) {
+        return;
+    }
+    take_ownership();
+
+    vector<vector<int32_t>> neighbours(nodes_count);
+    for (int e = 0; e < elements_count; ++e) {
+        const int32_t* ID = get_element_nodes(e);
+        for (int i = 0; i < nodes_per_element; ++i) {
+            for (int j = 0; j < nodes_per_element; ++j) {
+                if (i != j) {
+                    neighbours[ID[i]].push_back(ID[j]);
+                }
+            }
+        }
+    }
+    for (auto& list : neighbours) {
+        sort(list.begin(), list.end());
+        list.erase(unique(list.begin(), list.end()), list.end());
+    }
+
+    auto by_degree = [&](int32_t a, int32_t b) {
+        return neighbours[a].size() != neighbours[b].size() ? neighbours[a].size() < neighbours[b].size() : a < b;
+    };
+    for (auto& list : neighbours) {
+        sort(list.begin(), list.end(), by_degree);
+    }
+
+    // Breadth-first level order from start; returns the first node of the last level with
+    // the lowest degree, a pseudo-peripheral candidate.
+    vector<int> level(nodes_count, -1);
+    vector<int32_t> order;
+    order.reserve(nodes_count);
+    auto visit = [&](int32_t start, bool keep) {
+        size_t first = order.size();
+        level[start] = 0;
+        order.push_back(start);
+        for (size_t k = first; k < order.size(); ++k) {
+            int32_t node = order[k];
+            for (int32_t next : neighbours[node]) {
+                if (level[next] < 0) {
+                    level[next] = level[node] + 1;
+                    order.push_back(next);
+                }
+            }
+        }
+        int last_level = level[order.back()];
+        int32_t candidate = order.back();
+        for (size_t k = first; k < order.size(); ++k) {
+            if (level[order[k]] == last_level && by_degree(order[k], candidate)) {
+                candidate = order[k];
+            }
+        }
+        if (!keep) {
+            for (size_t k = first; k < order.size(); ++k) {
+                level[order[k]] = -1;
+            }
+            order.resize(first);
+        }
+        return make_pair(last_level, candidate);
+    };
+
+    for (int32_t seed = 0; seed < nodes_count; ++seed) {
+        if (level[seed] >= 0) {
+            continue;
+        }
+        int32_t start = seed;
+        for (int32_t node = seed; node < nodes_count; ++node) {
+            if (level[node] < 0 && by_degree(node, start)) {
+                start = node;
+            }
+        }
+        // George-Liu: move to the far end of the level structure while it keeps getting deeper.
+        auto levels = visit(start, false);
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            auto next = visit(levels.second, false);
+            if (next.first <= levels.first) {
+                break;
+            }
+            start = levels.second;
+            levels = next;
+        }
+        visit(start, true);
+    }
+
+    vector<int32_t> new_index(nodes_count);
+    for (int k = 0; k < nodes_count; ++k) {
+        new_index[order[nodes_count - 1 - k]] = k;
+    }
+
+    vector<double> x_new(nodes_count), y_new(nodes_count);
+    vector<int32_t> bc_new(nodes_count);
+    for (int i = 0; i < nodes_count; ++i) {
+        x_new[new_index[i]] = x_storage[i];
+        y_new[new_index[i]] = y_storage[i];
+        bc_new[new_index[i]] = bc_storage[i];
+    }
+    x_storage.swap(x_new);
+    y_storage.swap(y_new);
+    bc_storage.swap(bc_new);
+    for (auto& node : connectivity_storage) {
+        node = new_index[node];
+    }
+    bind_storage();
+
+    if (node_permutation.empty()) {
+        node_permutation.swap(new_index);
+    } else {
+        for (auto& node : node_permutation) {
+            node = new_index[node];
+        }
+    }
+    element_colors.clear();
+}
 
-            elements.push_back(new_element);  
+int Grid::get_bandwidth() const {
+    int bandwidth = 0;
+    for (int e = 0; e < elements_count; ++e) {
+        const int32_t* ID = get_element_nodes(e);
+        for (int i = 0; i < nodes_per_element; ++i) {
+            for (int j = i + 1; j < nodes_per_element; ++j) {
+                bandwidth = max(bandwidth, abs(ID[i] - ID[j]));
+            }
         }
     }
+    return bandwidth;
+}
+
+const int32_t* Grid::get_node_permutation() const {
+    return node_permutation.empty() ? nullptr : node_permutation.data();
+}
+
+void Grid::to_original_order(const vector<double>& values, vector<double>& original) const {
+    if (node_permutation.empty()) {
+        original = values;
+        return;
+    }
+    original.resize(node_permutation.size());
+    for (size_t i = 0; i < node_permutation.size(); ++i) {
+        original[i] = values[node_permutation[i]];
+    }
+}
+
+void Grid::from_original_order(const vector<double>& original, vector<double>& values) const {
+    if (node_permutation.empty()) {
+        values = original;
+        return;
+    }
+    values.resize(node_permutation.size());
+    for (size_t i = 0; i < node_permutation.size(); ++i) {
+        values[node_permutation[i]] = original[i];
+    }
+}
+
+void Grid::color_elements() {
+    element_colors.clear();
+    vector<vector<int>> node_colors(nodes_count);
+    vector<char> forbidden;
+    int elements_count = get_elements_count();
+
+    for (int e = 0; e < elements_count; ++e) {
+        const int32_t* ID = get_element_nodes(e);
+        forbidden.assign(element_colors.size() + 1, 0);
+        for (int k = 0; k < nodes_per_element; ++k) {
+            for (int color : node_colors[ID[k]]) {
+                forbidden[color] = 1;
+            }
+        }
+
+        int color = 0;
+        while (forbidden[color]) {
+            ++color;
+        }
+        if (color == static_cast<int>(element_colors.size())) {
+            element_colors.emplace_back();
+        }
+        element_colors[color].push_back(e);
+        for (int k = 0; k < nodes_per_element; ++k) {
+            node_colors[ID[k]].push_back(color);
+        }
+    }
+}
+
+const vector<vector<int>>& Grid::get_element_colors() {
+    if (element_colors.empty() && elements_count > 0) {
+        color_elements();
+    }
+    return element_colors;
 }
 
 void Grid::display_grid_data() {
     cout << "Nodes:" << endl << endl;
-    for (const auto& node : nodes_xy) {
-        node.display_node();
+    for (int i = 0; i < nodes_count; ++i) {
+        Node(x[i], y[i], bc[i]).display_node();
     }
     cout << "-----------------------------------" << endl;
     cout << "Elements:" << endl << endl;
-    for (const auto& element : elements) {  
-        element.display_ID(); 
+    for (int e = 0; e < get_elements_count(); ++e) {  
+        get_element(e).display_ID(); 
     }
     cout << "-----------------------------------" << endl;   
 }
\ No newline at end of file
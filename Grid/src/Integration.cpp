@@ -1,62 +1,22 @@
 #include "Integration.h"
 #include <iostream>
-#include <math.h>
 #include <functional>
 
 using std::cout;
 using std::endl;
 using std::cerr;
 using std::function;
+using std::vector;
 
-const double Integration::x2[2] = { -1.0 / sqrt(3.0), 1.0 / sqrt(3.0) };
-const double Integration::w2[2] = { 1.0, 1.0 };
-
-const double Integration::x3[3] = { -sqrt(3.0 / 5.0), 0.0, sqrt(3.0 / 5.0) };
-const double Integration::w3[3] = { 5.0 / 9.0, 8.0 / 9.0, 5.0 / 9.0 };
-
-const double Integration::x4[4] = { -sqrt((3.0 + 2.0 * sqrt(6.0 / 5.0)) / 7.0), -sqrt((3.0 - 2.0 * sqrt(6.0 / 5.0)) / 7.0), sqrt((3.0 - 2.0 * sqrt(6.0 / 5.0)) / 7.0), sqrt((3.0 + 2.0 * sqrt(6.0 / 5.0)) / 7.0) };
-const double Integration::w4[4] = { (18.0 - sqrt(30.0)) / 36.0, (18.0 + sqrt(30.0)) / 36.0, (18.0 + sqrt(30.0)) / 36.0, (18.0 - sqrt(30.0)) / 36.0 };
-
-const double Integration::x9[9] = { -0.968160, -0.836031, -0.613371, -0.324253, 0.0, 0.324253, 0.613371, 0.836031, 0.968160 };
-const double Integration::w9[9] = { 0.081274, 0.180648, 0.260611, 0.312347, 0.330239, 0.312347, 0.260611, 0.180648, 0.081274 };
-
-const double Integration::x16[16] = {
-    -0.989400934991649932596154173450,
-    -0.944575023073232576077988415535,
-    -0.865631202387831743880467897712,
-    -0.755404408355003033895101194847,
-    -0.617876244402643748446671764049,
-    -0.458016777657227386342419442984,
-    -0.281603550779258913230460501460,
-    -0.095012509837637440185319335425,
-     0.095012509837637440185319335425,
-     0.281603550779258913230460501460,
-     0.458016777657227386342419442984,
-     0.617876244402643748446671764049,
-     0.755404408355003033895101194847,
-     0.865631202387831743880467897712,
-     0.944575023073232576077988415535,
-     0.989400934991649932596154173450
-};
+template <int N>
+static vector<double> rule_points() {
+    return vector<double>(GaussRule<N>::points, GaussRule<N>::points + N);
+}
 
-const double Integration::w16[16] = {
-    0.027152459411754094851780572456,
-    0.062253523938647892862843836994,
-    0.095158511682492784809925107602,
-    0.124628971255533872052476282192,
-    0.149595988816576732081501730547,
-    0.169156519395002538189312079030,
-    0.182603415044923588866763667969,
-    0.189450610455068496285396723208,
-    0.189450610455068496285396723208,
-    0.182603415044923588866763667969,
-    0.169156519395002538189312079030,
-    0.149595988816576732081501730547,
-    0.124628971255533872052476282192,
-    0.095158511682492784809925107602,
-    0.062253523938647892862843836994,
-    0.027152459411754094851780572456
-};
+template <int N>
+static vector<double> rule_weights() {
+    return vector<double>(GaussRule<N>::weights, GaussRule<N>::weights + N);
+}
 
 Integration::Integration() {}
 
@@ -71,24 +31,24 @@ double Integration::gauss_integration_2D(function<double(double, double)> f, int
 
     switch (n) {
         case 2:
-            x = x2;
-            w = w2;
+            x = GaussRule<2>::points;
+            w = GaussRule<2>::weights;
             break;
         case 3:
-            x = x3;
-            w = w3;
+            x = GaussRule<3>::points;
+            w = GaussRule<3>::weights;
             break;
         case 4:
-            x = x4;
-            w = w4;
+            x = GaussRule<4>::points;
+            w = GaussRule<4>::weights;
             break;
         case 9:
-            x = x9;
-            w = w9;
+            x = GaussRule<9>::points;
+            w = GaussRule<9>::weights;
             break;
         case 16:
-            x = x16;
-            w = w16;
+            x = GaussRule<16>::points;
+            w = GaussRule<16>::weights;
             break;
         default:
             cerr << "Wrong number of points." << endl;
@@ -110,27 +70,31 @@ double Integration::gauss_integration_2D(function<double(double, double)> f, int
 }
 
 vector<double> Integration::get_weights(int order)  {
-    if (order == 2) {
-        return  { 1.0, 1.0 };
-    } else if (order == 4) {
-        return { (18.0 - sqrt(30.0)) / 36.0, (18.0 + sqrt(30.0)) / 36.0, (18.0 + sqrt(30.0)) / 36.0, (18.0 - sqrt(30.0)) / 36.0 };
-    } else if(order == 3) {
-        return { 5.0 / 9.0, 8.0 / 9.0, 5.0 / 9.0 };
-    } else {
-        cerr << "Wrong number of points!" << endl;
-        return {};
+    switch (order) {
+        case 2: return rule_weights<2>();
+        case 3: return rule_weights<3>();
+        case 4: return rule_weights<4>();
+        case 9: return rule_weights<9>();
+        case 16: return rule_weights<16>();
+        default:
+            cerr << "Wrong number of points!" << endl;
+            return {};
     }
 }
 
+bool Integration::is_supported_order(int order) {
+    return order == 2 || order == 3 || order == 4 || order == 9 || order == 16;
+}
+
 vector<double> Integration::get_points(int order)  {
-    if (order == 2) {
-        return { -1.0 / sqrt(3.0), 1.0 / sqrt(3.0) };
-    } else if (order == 4) {
-        return { -sqrt((3.0 + 2.0 * sqrt(6.0 / 5.0)) / 7.0), -sqrt((3.0 - 2.0 * sqrt(6.0 / 5.0)) / 7.0), sqrt((3.0 - 2.0 * sqrt(6.0 / 5.0)) / 7.0), sqrt((3.0 + 2.0 * sqrt(6.0 / 5.0)) / 7.0) };
-    } else if(order == 3) {
-        return { -sqrt(3.0 / 5.0), 0.0, sqrt(3.0 / 5.0) };
-    } else {
-        cerr << "Wrong number of points!" << endl;
-        return {};
+    switch (order) {
+        case 2: return rule_points<2>();
+        case 3: return rule_points<3>();
+        case 4: return rule_points<4>();
+        case 9: return rule_points<9>();
+        case 16: return rule_points<16>();
+        default:
+            cerr << "Wrong number of points!" << endl;
+            return {};
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,172 @@
+#include "LDLTSolver.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::abs;
+
+LDLTSolver::LDLTSolver() : n(0), factorized(false) {}
+
+void LDLTSolver::analyze(const SparseMatrix& A) {
+    n = A.size();
+    pattern_row_ptr = A.get_row_ptr();
+    pattern_col_idx = A.get_col_idx();
+
+    parent.assign(n, -1);
+    L_col_ptr.assign(n + 1, 0);
+    vector<int> flag(n, -1);
+    vector<int> column_count(n, 0);
+
+    for (int k = 0; k < n; ++k) {
+        flag[k] = k;
+        for (int p = pattern_row_ptr[k]; p < pattern_row_ptr[k + 1]; ++p) {
+            int i = pattern_col_idx[p];
+            if (i >= k) {
+                continue;
+            }
+            for (; flag[i] != k; i = parent[i]) {
+                if (parent[i] == -1) {
+                    parent[i] = k;
+                }
+                column_count[i]++;
+                flag[i] = k;
+            }
+        }
+    }
+
+    for (int k = 0; k < n; ++k) {
+        L_col_ptr[k + 1] = L_col_ptr[k] + column_count[k];
+    }
+    L_row_idx.assign(L_col_ptr[n], 0);
+    L_values.assign(L_col_ptr[n], 0.0);
+    D.assign(n, 0.0);
+}
+
+bool LDLTSolver::factorize(const SparseMatrix& A) {
+    factorized = false;
+    if (A.size() != n || A.get_row_ptr() != pattern_row_ptr || A.get_col_idx() != pattern_col_idx) {
+        analyze(A);
+    }
+
+    const auto& values = A.get_values();
+    vector<double> y(n, 0.0);
+    vector<int> pattern(n), flag(n, -1), column_fill(n, 0);
+
+    for (int k = 0; k < n; ++k) {
+        int top = n;
+        flag[k] = k;
+
+        for (int p = pattern_row_ptr[k]; p < pattern_row_ptr[k + 1]; ++p) {
+            int i = pattern_col_idx[p];
+            if (i > k) {
+                continue;
+            }
+            y[i] += values[p];
+            int len = 0;
+            for (; flag[i] != k; i = parent[i]) {
+                pattern[len++] = i;
+                flag[i] = k;
+            }
+            while (len > 0) {
+                pattern[--top] = pattern[--len];
+            }
+        }
+
+        D[k] = y[k];
+        y[k] = 0.0;
+
+        for (; top < n; ++top) {
+            int i = pattern[top];
+            double yi = y[i];
+            y[i] = 0.0;
+            int p_end = L_col_ptr[i] + column_fill[i];
+            for (int p = L_col_ptr[i]; p < p_end; ++p) {
+                y[L_row_idx[p]] -= L_values[p] * yi;
+            }
+            double l_ki = yi / D[i];
+            D[k] -= l_ki * yi;
+            L_row_idx[p_end] = k;
+            L_values[p_end] = l_ki;
+            column_fill[i]++;
+        }
+
+        if (abs(D[k]) < 1e-12) {
+            cerr << "The matrix is singular, the system cannot be solved (pivot " << k << ")." << endl;
+            return false;
+        }
+    }
+
+    factorized = true;
+    return true;
+}
+
+bool LDLTSolver::solve(const vector<double>& b, vector<double>& x) {
+    if (!factorized) {
+        cerr << "Error: LDLT solve called before a successful factorization." << endl;
+        return false;
+    }
+
+    x = b;
+    for (int j = 0; j < n; ++j) {
+        for (int p = L_col_ptr[j]; p < L_col_ptr[j + 1]; ++p) {
+            x[L_row_idx[p]] -= L_values[p] * x[j];
+        }
+    }
+    for (int j = 0; j < n; ++j) {
+        x[j] /= D[j];
+    }
+    for (int j = n - 1; j >= 0; --j) {
+        for (int p = L_col_ptr[j]; p < L_col_ptr[j + 1]; ++p) {
+            x[j] -= L_values[p] * x[L_row_idx[p]];
+        }
+    }
+    return true;
+}
+
+// Same substitutions as solve(), applied to all right-hand sides of a node at once: every
+// factor entry is loaded once and used for a contiguous row of rhs_count values.
+bool LDLTSolver::solve_block(const vector<double>& B, vector<double>& X, int rhs_count) {
+    if (!factorized) {
+        cerr << "Error: LDLT solve called before a successful factorization." << endl;
+        return false;
+    }
+
+    X = B;
+    double* x = X.data();
+    for (int j = 0; j < n; ++j) {
+        const double* x_j = x + static_cast<size_t>(j) * rhs_count;
+        for (int p = L_col_ptr[j]; p < L_col_ptr[j + 1]; ++p) {
+            double l = L_values[p];
+            double* x_row = x + static_cast<size_t>(L_row_idx[p]) * rhs_count;
+            for (int k = 0; k < rhs_count; ++k) {
+                x_row[k] -= l * x_j[k];
+            }
+        }
+    }
+    for (int j = 0; j < n; ++j) {
+        double* x_j = x + static_cast<size_t>(j) * rhs_count;
+        for (int k = 0; k < rhs_count; ++k) {
+            x_j[k] /= D[j];
+        }
+    }
+    for (int j = n - 1; j >= 0; --j) {
+        double* x_j = x + static_cast<size_t>(j) * rhs_count;
+        for (int p = L_col_ptr[j]; p < L_col_ptr[j + 1]; ++p) {
+            double l = L_values[p];
+            const double* x_row = x + static_cast<size_t>(L_row_idx[p]) * rhs_count;
+            for (int k = 0; k < rhs_count; ++k) {
+                x_j[k] -= l * x_row[k];
+            }
+        }
+    }
+    return true;
+}
+
+string LDLTSolver::name() const { return "LDLT"; }
+
+bool LDLTSolver::is_factorized() const { return factorized; }
+int LDLTSolver::size() const { return n; }
+int LDLTSolver::factor_nnz() const { return L_col_ptr.empty() ? 0 : L_col_ptr[n]; }
@@ -0,0 +1,72 @@
+#include "LinearSolver.h"
+#include "BandedCholeskySolver.h"
+#include "LDLTSolver.h"
+#include "PCGSolver.h"
+#include <iostream>
+#include <memory>
+#include <string>
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::unique_ptr;
+using std::make_unique;
+
+bool LinearSolver::factorize(const LinearOperator&) {
+    cerr << "Error: the " << name() << " solver needs an assembled matrix." << endl;
+    return false;
+}
+
+bool LinearSolver::solve_block(const vector<double>& B, vector<double>& X, int rhs_count) {
+    size_t n = B.size() / rhs_count;
+    if (X.size() != B.size()) {
+        X.assign(B.size(), 0.0);
+    }
+
+    vector<double> b(n), x(n);
+    bool converged = true;
+    for (int k = 0; k < rhs_count; ++k) {
+        for (size_t i = 0; i < n; ++i) {
+            b[i] = B[i * rhs_count + k];
+            x[i] = X[i * rhs_count + k];
+        }
+        converged = solve(b, x) && converged;
+        for (size_t i = 0; i < n; ++i) {
+            X[i * rhs_count + k] = x[i];
+        }
+    }
+    return converged;
+}
+
+int LinearSolver::get_last_iterations() const {
+    return 0;
+}
+
+unique_ptr<LinearSolver> create_linear_solver(SolverType type, double tolerance, int max_iterations) {
+    switch (type) {
+        case SolverType::PCG_Jacobi:
+            return make_unique<PCGSolver>(Preconditioner::Jacobi, tolerance, max_iterations);
+        case SolverType::PCG_IC0:
+            return make_unique<PCGSolver>(Preconditioner::IC0, tolerance, max_iterations);
+        case SolverType::Banded:
+            return make_unique<BandedCholeskySolver>();
+        case SolverType::LDLT:
+        default:
+            return make_unique<LDLTSolver>();
+    }
+}
+
+bool parse_solver_type(const string& text, SolverType& type) {
+    if (text == "ldlt") {
+        type = SolverType::LDLT;
+    } else if (text == "pcg-jacobi") {
+        type = SolverType::PCG_Jacobi;
+    } else if (text == "pcg-ic0") {
+        type = SolverType::PCG_IC0;
+    } else if (text == "banded") {
+        type = SolverType::Banded;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+#include "Logger.h"
+
+#ifdef NDEBUG
+LogLevel Logger::level = LogLevel::Info;
+#else
+LogLevel Logger::level = LogLevel::Debug;
+#endif
+
+void Logger::set_level(LogLevel new_level) {
+    level = new_level;
+}
+
+LogLevel Logger::get_level() {
+    return level;
+}
+
+bool Logger::enabled(LogLevel message_level) {
+    return static_cast<int>(message_level) <= static_cast<int>(level);
+}
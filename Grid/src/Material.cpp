@@ -0,0 +1,56 @@
+#include "Material.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using std::vector;
+using std::function;
+using std::upper_bound;
+using std::move;
+
+MaterialProperty::MaterialProperty(double value) : constant(value) {}
+
+MaterialProperty MaterialProperty::from_table(vector<double> p_temperatures, vector<double> p_values) {
+    MaterialProperty property(p_values.empty() ? 0.0 : p_values[0]);
+    if (p_temperatures.size() > 1 && p_temperatures.size() == p_values.size()) {
+        property.temperatures = move(p_temperatures);
+        property.values = move(p_values);
+    }
+    return property;
+}
+
+MaterialProperty MaterialProperty::from_function(function<double(double)> p_callback) {
+    MaterialProperty property;
+    property.callback = move(p_callback);
+    return property;
+}
+
+bool MaterialProperty::is_constant() const {
+    return temperatures.empty() && !callback;
+}
+
+double MaterialProperty::evaluate(double temperature) const {
+    if (callback) {
+        return callback(temperature);
+    }
+    if (temperatures.empty()) {
+        return constant;
+    }
+    if (temperature <= temperatures.front()) {
+        return values.front();
+    }
+    if (temperature >= temperatures.back()) {
+        return values.back();
+    }
+    size_t k = upper_bound(temperatures.begin(), temperatures.end(), temperature) - temperatures.begin();
+    double s = (temperature - temperatures[k - 1]) / (temperatures[k] - temperatures[k - 1]);
+    return values[k - 1] + s * (values[k] - values[k - 1]);
+}
+
+bool Material::is_constant() const {
+    return conductivity.is_constant() && density.is_constant() && specific_heat.is_constant();
+}
+
+double Material::get_capacity(double temperature) const {
+    return density.evaluate(temperature) * specific_heat.evaluate(temperature);
+}
@@ -0,0 +1,282 @@
+#include "MeshLoader.h"
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::string;
+using std::shared_ptr;
+using std::make_shared;
+using std::ifstream;
+using std::ofstream;
+using std::ios;
+using std::from_chars;
+using std::errc;
+using std::memcmp;
+using std::memcpy;
+
+namespace {
+
+const char binary_magic[8] = { 'F', 'E', 'M', 'M', 'E', 'S', 'H', '1' };
+const char binary_magic_v2[8] = { 'F', 'E', 'M', 'M', 'E', 'S', 'H', '2' };
+const size_t binary_header_size = sizeof(binary_magic) + 2 * sizeof(int64_t);
+const size_t binary_header_v2_size = binary_header_size + 2 * sizeof(int32_t);
+
+const char* skip_blanks(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        ++p;
+    }
+    return p;
+}
+
+const char* skip_line(const char* p, const char* end) {
+    while (p < end && *p != '\n') {
+        ++p;
+    }
+    return p < end ? p + 1 : p;
+}
+
+template <typename T>
+bool parse_field(const char*& p, const char* end, T& value) {
+    p = skip_blanks(p, end);
+    auto result = from_chars(p, end, value);
+    if (result.ec != errc()) {
+        return false;
+    }
+    p = result.ptr;
+    return true;
+}
+
+}
+
+MappedFile::MappedFile() : data(nullptr), length(0) {
+#ifdef _WIN32
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = nullptr;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string& path) {
+    close();
+#ifdef _WIN32
+    file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+        close();
+        return false;
+    }
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle == nullptr) {
+        close();
+        return false;
+    }
+    data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr) {
+        close();
+        return false;
+    }
+    length = file_size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    madvise(mapping, file_stat.st_size, MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapping);
+    length = file_stat.st_size;
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping_handle != nullptr) {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_handle);
+    }
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = nullptr;
+#else
+    if (data != nullptr) {
+        munmap(const_cast<char*>(data), length);
+    }
+#endif
+    data = nullptr;
+    length = 0;
+}
+
+const char* MappedFile::get_data() const { return data; }
+size_t MappedFile::size() const { return length; }
+
+bool MeshLoader::is_binary_mesh(const string& path) {
+    ifstream file(path, ios::binary);
+    char magic[sizeof(binary_magic)];
+    return file.read(magic, sizeof(magic))
+        && (memcmp(magic, binary_magic, sizeof(magic)) == 0 || memcmp(magic, binary_magic_v2, sizeof(magic)) == 0);
+}
+
+bool MeshLoader::load_text_nodes(const string& path, size_t expected_nodes, vector<double>& x, vector<double>& y, vector<int32_t>& bc) {
+    MappedFile file;
+    if (!file.open(path)) {
+        cerr << "Error: File: " << path << " not found or empty." << endl;
+        return false;
+    }
+
+    x.clear();
+    y.clear();
+    bc.clear();
+    x.reserve(expected_nodes);
+    y.reserve(expected_nodes);
+    bc.reserve(expected_nodes);
+
+    const char* p = file.get_data();
+    const char* end = p + file.size();
+    size_t line_number = 0;
+
+    while (p < end) {
+        ++line_number;
+        const char* line_start = p;
+        p = skip_blanks(p, end);
+        if (p == end || *p == '\n') {
+            p = skip_line(p, end);
+            continue;
+        }
+
+        double node_x, node_y;
+        int32_t node_bc;
+        if (!parse_field(p, end, node_x) || !parse_field(p, end, node_y) || !parse_field(p, end, node_bc)) {
+            const char* line_end = skip_line(line_start, end);
+            cerr << "Error: Failed to read line " << line_number << ": " << string(line_start, line_end - line_start) << endl;
+            return false;
+        }
+        x.push_back(node_x);
+        y.push_back(node_y);
+        bc.push_back(node_bc);
+        p = skip_line(p, end);
+    }
+
+    if (x.empty()) {
+        cerr << "Error: No nodes were loaded from " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+shared_ptr<MappedFile> MeshLoader::map_binary_mesh(const string& path, BinaryMeshView& view) {
+    auto file = make_shared<MappedFile>();
+    if (!file->open(path)) {
+        cerr << "Error: File: " << path << " not found or empty." << endl;
+        return nullptr;
+    }
+
+    const char* data = file->get_data();
+    bool version_2 = file->size() >= binary_header_v2_size && memcmp(data, binary_magic_v2, sizeof(binary_magic_v2)) == 0;
+    if (!version_2 && (file->size() < binary_header_size || memcmp(data, binary_magic, sizeof(binary_magic)) != 0)) {
+        cerr << "Error: " << path << " is not a binary mesh file." << endl;
+        return nullptr;
+    }
+
+    memcpy(&view.nodes_count, data + sizeof(binary_magic), sizeof(int64_t));
+    memcpy(&view.elements_count, data + sizeof(binary_magic) + sizeof(int64_t), sizeof(int64_t));
+    int32_t element_type = 0;
+    if (version_2) {
+        memcpy(&element_type, data + binary_header_size, sizeof(int32_t));
+    }
+    if (element_type < 0 || element_type > static_cast<int32_t>(ElementType::Tri3)) {
+        cerr << "Error: " << path << " has an unknown element type " << element_type << "." << endl;
+        return nullptr;
+    }
+    view.element_type = static_cast<ElementType>(element_type);
+    int64_t nodes_per_element = get_element_nodes_count(view.element_type);
+
+    size_t header_size = version_2 ? binary_header_v2_size : binary_header_size;
+    size_t expected_size = header_size + view.nodes_count * (2 * sizeof(double) + sizeof(int32_t))
+        + view.elements_count * nodes_per_element * sizeof(int32_t);
+    if (view.nodes_count <= 0 || view.elements_count <= 0 || file->size() < expected_size) {
+        cerr << "Error: " << path << " is truncated or has an invalid header." << endl;
+        return nullptr;
+    }
+
+    const char* section = data + header_size;
+    view.x = reinterpret_cast<const double*>(section);
+    section += view.nodes_count * sizeof(double);
+    view.y = reinterpret_cast<const double*>(section);
+    section += view.nodes_count * sizeof(double);
+    view.bc = reinterpret_cast<const int32_t*>(section);
+    section += view.nodes_count * sizeof(int32_t);
+    view.connectivity = reinterpret_cast<const int32_t*>(section);
+
+    for (int64_t k = 0; k < nodes_per_element * view.elements_count; ++k) {
+        if (view.connectivity[k] < 0 || view.connectivity[k] >= view.nodes_count) {
+            cerr << "Error: " << path << " references node " << view.connectivity[k] << " outside the mesh." << endl;
+            return nullptr;
+        }
+    }
+    return file;
+}
+
+bool MeshLoader::write_binary_mesh(const string& path, const BinaryMeshView& view) {
+    ofstream file(path, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: Cannot open " << path << " for writing." << endl;
+        return false;
+    }
+
+    bool version_2 = view.element_type != ElementType::Quad4;
+    file.write(version_2 ? binary_magic_v2 : binary_magic, sizeof(binary_magic));
+    file.write(reinterpret_cast<const char*>(&view.nodes_count), sizeof(int64_t));
+    file.write(reinterpret_cast<const char*>(&view.elements_count), sizeof(int64_t));
+    if (version_2) {
+        int32_t type_and_padding[2] = { static_cast<int32_t>(view.element_type), 0 };
+        file.write(reinterpret_cast<const char*>(type_and_padding), sizeof(type_and_padding));
+    }
+    file.write(reinterpret_cast<const char*>(view.x), view.nodes_count * sizeof(double));
+    file.write(reinterpret_cast<const char*>(view.y), view.nodes_count * sizeof(double));
+    file.write(reinterpret_cast<const char*>(view.bc), view.nodes_count * sizeof(int32_t));
+    file.write(reinterpret_cast<const char*>(view.connectivity), view.elements_count * get_element_nodes_count(view.element_type) * sizeof(int32_t));
+
+    if (!file) {
+        cerr << "Error: Failed to write " << path << endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,205 @@
+#include "PCGSolver.h"
+#include <iostream>
+#include <vector>
+#include <cmath>
+
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::sqrt;
+using std::abs;
+
+PCGSolver::PCGSolver(Preconditioner preconditioner, double tolerance, int max_iterations)
+    : A(nullptr), matrix(nullptr), preconditioner(preconditioner), active_preconditioner(preconditioner), tolerance(tolerance),
+      max_iterations(max_iterations), last_iterations(0), last_residual(0.0) {}
+
+bool PCGSolver::factorize(const SparseMatrix& A_matrix) {
+    matrix = &A_matrix;
+    if (!factorize(static_cast<const LinearOperator&>(A_matrix))) {
+        return false;
+    }
+
+    if (active_preconditioner == Preconditioner::IC0 && !build_ic0()) {
+        cerr << "IC(0) breakdown, falling back to the Jacobi preconditioner." << endl;
+        active_preconditioner = Preconditioner::Jacobi;
+    }
+    return true;
+}
+
+bool PCGSolver::factorize(const LinearOperator& op) {
+    active_preconditioner = preconditioner;
+    if (&op != matrix) {
+        matrix = nullptr;
+        if (active_preconditioner == Preconditioner::IC0) {
+            cerr << "IC(0) needs an assembled matrix, using the Jacobi preconditioner." << endl;
+            active_preconditioner = Preconditioner::Jacobi;
+        }
+    }
+    A = &op;
+    int n = A->size();
+
+    A->get_diagonal(inv_diagonal);
+    for (int row = 0; row < n; ++row) {
+        if (abs(inv_diagonal[row]) <= 1e-300) {
+            cerr << "Error: zero diagonal entry in row " << row << ", PCG cannot be used." << endl;
+            return false;
+        }
+        inv_diagonal[row] = 1.0 / inv_diagonal[row];
+    }
+    return true;
+}
+
+bool PCGSolver::build_ic0() {
+    int n = matrix->size();
+    const auto& row_ptr = matrix->get_row_ptr();
+    const auto& col_idx = matrix->get_col_idx();
+    const auto& values = matrix->get_values();
+
+    L_row_ptr.assign(n + 1, 0);
+    L_col_idx.clear();
+    L_values.clear();
+    for (int row = 0; row < n; ++row) {
+        for (int k = row_ptr[row]; k < row_ptr[row + 1] && col_idx[k] <= row; ++k) {
+            L_col_idx.push_back(col_idx[k]);
+            L_values.push_back(values[k]);
+        }
+        L_row_ptr[row + 1] = L_col_idx.size();
+    }
+
+    for (int i = 0; i < n; ++i) {
+        for (int p = L_row_ptr[i]; p < L_row_ptr[i + 1]; ++p) {
+            int k = L_col_idx[p];
+            double sum = L_values[p];
+
+            int a = L_row_ptr[i];
+            int b = L_row_ptr[k];
+            while (a < p && b < L_row_ptr[k + 1] - 1) {
+                if (L_col_idx[a] == L_col_idx[b]) {
+                    sum -= L_values[a++] * L_values[b++];
+                } else if (L_col_idx[a] < L_col_idx[b]) {
+                    ++a;
+                } else {
+                    ++b;
+                }
+            }
+
+            if (k < i) {
+                L_values[p] = sum / L_values[L_row_ptr[k + 1] - 1];
+            } else {
+                if (sum <= 0.0) {
+                    return false;
+                }
+                L_values[p] = sqrt(sum);
+            }
+        }
+    }
+    return true;
+}
+
+void PCGSolver::apply_preconditioner(const vector<double>& r, vector<double>& z) const {
+    int n = r.size();
+    if (active_preconditioner == Preconditioner::Jacobi) {
+        for (int i = 0; i < n; ++i) {
+            z[i] = inv_diagonal[i] * r[i];
+        }
+        return;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        double sum = r[i];
+        int diag = L_row_ptr[i + 1] - 1;
+        for (int p = L_row_ptr[i]; p < diag; ++p) {
+            sum -= L_values[p] * z[L_col_idx[p]];
+        }
+        z[i] = sum / L_values[diag];
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        int diag = L_row_ptr[i + 1] - 1;
+        z[i] /= L_values[diag];
+        for (int p = L_row_ptr[i]; p < diag; ++p) {
+            z[L_col_idx[p]] -= L_values[p] * z[i];
+        }
+    }
+}
+
+bool PCGSolver::solve(const vector<double>& b, vector<double>& x) {
+    if (A == nullptr) {
+        cerr << "Error: PCG solve called before factorize." << endl;
+        return false;
+    }
+
+    int n = A->size();
+    if (static_cast<int>(x.size()) != n) {
+        x.assign(n, 0.0);
+    }
+
+    r.resize(n);
+    z.resize(n);
+    p.resize(n);
+    Ap.resize(n);
+    A->apply(x, Ap);
+
+    double b_norm = 0.0;
+    for (int i = 0; i < n; ++i) {
+        r[i] = b[i] - Ap[i];
+        b_norm += b[i] * b[i];
+    }
+    b_norm = sqrt(b_norm);
+    if (b_norm == 0.0) {
+        b_norm = 1.0;
+    }
+
+    apply_preconditioner(r, z);
+    p = z;
+    double rz = 0.0, r_norm = 0.0;
+    for (int i = 0; i < n; ++i) {
+        rz += r[i] * z[i];
+        r_norm += r[i] * r[i];
+    }
+
+    last_iterations = 0;
+    last_residual = sqrt(r_norm) / b_norm;
+
+    while (last_residual > tolerance && last_iterations < max_iterations) {
+        A->apply(p, Ap);
+        double pAp = 0.0;
+        for (int i = 0; i < n; ++i) {
+            pAp += p[i] * Ap[i];
+        }
+        double alpha = rz / pAp;
+
+        r_norm = 0.0;
+        for (int i = 0; i < n; ++i) {
+            x[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+            r_norm += r[i] * r[i];
+        }
+
+        apply_preconditioner(r, z);
+        double rz_new = 0.0;
+        for (int i = 0; i < n; ++i) {
+            rz_new += r[i] * z[i];
+        }
+        double beta = rz_new / rz;
+        rz = rz_new;
+        for (int i = 0; i < n; ++i) {
+            p[i] = z[i] + beta * p[i];
+        }
+
+        ++last_iterations;
+        last_residual = sqrt(r_norm) / b_norm;
+    }
+
+    if (last_residual > tolerance) {
+        cerr << "PCG did not converge: residual " << last_residual << " after " << last_iterations << " iterations." << endl;
+        return false;
+    }
+    return true;
+}
+
+string PCGSolver::name() const {
+    return active_preconditioner == Preconditioner::IC0 ? "PCG (IC(0))" : "PCG (Jacobi)";
+}
+
+int PCGSolver::get_last_iterations() const { return last_iterations; }
+double PCGSolver::get_last_residual() const { return last_residual; }
@@ -0,0 +1,126 @@
+#include "Profiler.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+using std::cerr;
+using std::endl;
+using std::string;
+using std::vector;
+using std::set;
+using std::ofstream;
+using std::setprecision;
+using std::lock_guard;
+using std::mutex;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+mutex Profiler::stats_mutex;
+vector<PhaseStats> Profiler::phases;
+
+PhaseStats& Profiler::find_phase(const string& name) {
+    for (auto& phase : phases) {
+        if (phase.name == name) {
+            return phase;
+        }
+    }
+    phases.push_back({ name, 0, 0.0, {} });
+    return phases.back();
+}
+
+void Profiler::record(const string& phase, double seconds) {
+    lock_guard<mutex> lock(stats_mutex);
+    PhaseStats& stats = find_phase(phase);
+    ++stats.calls;
+    stats.seconds += seconds;
+}
+
+void Profiler::add_counter(const string& phase, const string& counter, double value) {
+    lock_guard<mutex> lock(stats_mutex);
+    find_phase(phase).counters[counter] += value;
+}
+
+void Profiler::reset() {
+    lock_guard<mutex> lock(stats_mutex);
+    phases.clear();
+}
+
+vector<PhaseStats> Profiler::get_phases() {
+    lock_guard<mutex> lock(stats_mutex);
+    return phases;
+}
+
+bool Profiler::write_json(const string& path) {
+    ofstream file(path);
+    if (!file.is_open()) {
+        cerr << "Error: Cannot open " << path << " for writing." << endl;
+        return false;
+    }
+
+    file << setprecision(9);
+    file << "{\n  \"phases\": [";
+    vector<PhaseStats> snapshot = get_phases();
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        const PhaseStats& phase = snapshot[i];
+        file << (i == 0 ? "\n" : ",\n");
+        file << "    { \"name\": \"" << phase.name << "\", \"calls\": " << phase.calls << ", \"seconds\": " << phase.seconds << ", \"counters\": {";
+        size_t k = 0;
+        for (const auto& counter : phase.counters) {
+            file << (k++ == 0 ? " " : ", ") << "\"" << counter.first << "\": " << counter.second;
+        }
+        file << (phase.counters.empty() ? "} }" : " } }");
+    }
+    file << "\n  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+bool Profiler::write_csv(const string& path) {
+    ofstream file(path);
+    if (!file.is_open()) {
+        cerr << "Error: Cannot open " << path << " for writing." << endl;
+        return false;
+    }
+
+    vector<PhaseStats> snapshot = get_phases();
+    set<string> counter_names;
+    for (const auto& phase : snapshot) {
+        for (const auto& counter : phase.counters) {
+            counter_names.insert(counter.first);
+        }
+    }
+
+    file << setprecision(9);
+    file << "phase,calls,seconds";
+    for (const auto& name : counter_names) {
+        file << "," << name;
+    }
+    file << "\n";
+    for (const auto& phase : snapshot) {
+        file << phase.name << "," << phase.calls << "," << phase.seconds;
+        for (const auto& name : counter_names) {
+            auto it = phase.counters.find(name);
+            file << ",";
+            if (it != phase.counters.end()) {
+                file << it->second;
+            }
+        }
+        file << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+bool Profiler::write(const string& path) {
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0) {
+        return write_csv(path);
+    }
+    return write_json(path);
+}
+
+ScopedTimer::ScopedTimer(const char* p_phase) : phase(p_phase), start(steady_clock::now()) {}
+
+ScopedTimer::~ScopedTimer() {
+    Profiler::record(phase, duration<double>(steady_clock::now() - start).count());
+}
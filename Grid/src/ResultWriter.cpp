@@ -0,0 +1,342 @@
+#include "ResultWriter.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+using std::cerr;
+using std::endl;
+using std::fixed;
+using std::setprecision;
+using std::ios;
+using std::swap;
+using std::floor;
+using std::llround;
+using std::memcpy;
+using std::mutex;
+using std::unique_lock;
+using std::lock_guard;
+using std::thread;
+
+static const char binary_magic[8] = { 'F', 'E', 'M', 'T', 'E', 'M', 'P', '1' };
+static const char binary_magic_v2[8] = { 'F', 'E', 'M', 'T', 'E', 'M', 'P', '2' };
+static const int64_t delta_key_interval = 100;
+
+FieldStats compute_field_stats(const vector<double>& values) {
+    if (values.empty()) {
+        return { 0.0, 0.0, 0.0 };
+    }
+    FieldStats stats = { values[0], values[0], 0.0 };
+    double sum = 0.0;
+    for (double value : values) {
+        stats.min = value < stats.min ? value : stats.min;
+        stats.max = value > stats.max ? value : stats.max;
+        sum += value;
+    }
+    stats.mean = sum / values.size();
+    return stats;
+}
+
+ResultWriter::ResultWriter()
+    : format(ResultFormat::Text), nodes_count(0), values_count(0), steps_written(0), steps_offered(0), last_offered_time(0.0),
+      node_order(nullptr), pending_time(0.0), writing_time(0.0), pending_stats(), writing_stats(), frames_since_key(0),
+      has_pending(false), writing(false), stopping(false) {}
+
+ResultWriter::~ResultWriter() {
+    close();
+}
+
+bool ResultWriter::start(int nodes) {
+    for (int32_t probe : options.probes) {
+        if (probe < 0 || probe >= nodes) {
+            cerr << "Error: probe node " << probe << " is outside the mesh (" << nodes << " nodes)." << endl;
+            return false;
+        }
+    }
+    nodes_count = nodes;
+    values_count = !options.fields ? 0 : options.probes.empty() ? nodes : options.probes.size();
+    steps_offered = 0;
+    last_offered_time = 0.0;
+    frames_since_key = 0;
+    has_pending = false;
+    writing = false;
+    stopping = false;
+    pending_frame.assign(values_count, 0.0);
+    writing_frame.assign(values_count, 0.0);
+    previous_quantized.assign(options.encoding == FrameEncoding::Delta ? values_count : 0, 0);
+    encoded.clear();
+    encoded.reserve(options.encoding == FrameEncoding::Delta ? 10 * values_count : options.encoding == FrameEncoding::Float ? 4 * values_count : 0);
+    return true;
+}
+
+bool ResultWriter::uses_header_v2() const {
+    return format == ResultFormat::Binary && (!options.probes.empty() || !options.fields || options.encoding != FrameEncoding::Double);
+}
+
+void ResultWriter::set_options(const OutputOptions& p_options) {
+    options = p_options;
+}
+
+bool ResultWriter::open(const string& path, ResultFormat p_format, int nodes, double time_step) {
+    close();
+
+    format = p_format;
+    if (!start(nodes)) {
+        return false;
+    }
+    steps_written = 0;
+
+    if (format == ResultFormat::Binary) {
+        file.open(path, ios::binary | ios::trunc);
+    } else {
+        file.open(path, ios::trunc);
+    }
+    if (!file.is_open()) {
+        cerr << "Error opening file for writing results: " << path << endl;
+        return false;
+    }
+
+    if (uses_header_v2()) {
+        int64_t steps = 0;
+        int32_t encoding = !options.fields ? 3 : static_cast<int32_t>(options.encoding);
+        int32_t probes_count = options.probes.size();
+        file.write(binary_magic_v2, sizeof(binary_magic_v2));
+        file.write(reinterpret_cast<const char*>(&values_count), sizeof(values_count));
+        file.write(reinterpret_cast<const char*>(&time_step), sizeof(time_step));
+        file.write(reinterpret_cast<const char*>(&steps), sizeof(steps));
+        file.write(reinterpret_cast<const char*>(&encoding), sizeof(encoding));
+        file.write(reinterpret_cast<const char*>(&probes_count), sizeof(probes_count));
+        file.write(reinterpret_cast<const char*>(&options.delta_resolution), sizeof(options.delta_resolution));
+        file.write(reinterpret_cast<const char*>(options.probes.data()), probes_count * sizeof(int32_t));
+    } else if (format == ResultFormat::Binary) {
+        int64_t steps = 0;
+        file.write(binary_magic, sizeof(binary_magic));
+        file.write(reinterpret_cast<const char*>(&nodes_count), sizeof(nodes_count));
+        file.write(reinterpret_cast<const char*>(&time_step), sizeof(time_step));
+        file.write(reinterpret_cast<const char*>(&steps), sizeof(steps));
+    } else {
+        file << fixed << setprecision(5);
+        file << "Simulation results:\n";
+        if (!options.probes.empty()) {
+            file << "Probe nodes:";
+            for (int32_t probe : options.probes) {
+                file << " " << probe;
+            }
+            file << "\n";
+        }
+        file << "\n";
+    }
+
+    writer_thread = thread(&ResultWriter::run, this);
+    return true;
+}
+
+bool ResultWriter::resume(const string& path, ResultFormat p_format, int nodes, int64_t offset, int64_t frames_written) {
+    close();
+
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    if (error || static_cast<int64_t>(size) < offset) {
+        cerr << "Error: results file " << path << " is missing or shorter than the checkpoint." << endl;
+        return false;
+    }
+    std::filesystem::resize_file(path, offset, error);
+    if (error) {
+        cerr << "Error: cannot truncate " << path << ": " << error.message() << endl;
+        return false;
+    }
+
+    format = p_format;
+    if (!start(nodes)) {
+        return false;
+    }
+    steps_written = frames_written;
+
+    file.open(path, format == ResultFormat::Binary ? ios::in | ios::out | ios::binary : ios::in | ios::out);
+    if (!file.is_open()) {
+        cerr << "Error opening file for writing results: " << path << endl;
+        return false;
+    }
+    file.seekp(0, ios::end);
+    if (format == ResultFormat::Text) {
+        file << fixed << setprecision(5);
+    }
+
+    writer_thread = thread(&ResultWriter::run, this);
+    return true;
+}
+
+int64_t ResultWriter::flush() {
+    if (!file.is_open()) {
+        return 0;
+    }
+    unique_lock<mutex> lock(buffer_mutex);
+    buffer_free.wait(lock, [this] { return !has_pending && !writing; });
+    file.flush();
+    return static_cast<int64_t>(file.tellp());
+}
+
+int64_t ResultWriter::get_frames_written() const {
+    return steps_written;
+}
+
+void ResultWriter::set_node_order(const int32_t* order) {
+    node_order = order;
+}
+
+void ResultWriter::restore_schedule(int64_t steps, double time) {
+    steps_offered = steps;
+    last_offered_time = time;
+}
+
+bool ResultWriter::is_frame_due(double time) const {
+    if (options.every_time > 0.0) {
+        return floor(time / options.every_time + 1e-9) > floor(last_offered_time / options.every_time + 1e-9);
+    }
+    return (steps_offered + 1) % options.every_steps == 0;
+}
+
+void ResultWriter::write_frame(double time, const vector<double>& temperatures) {
+    store_frame(time, temperatures, nullptr);
+}
+
+void ResultWriter::write_frame(double time, const vector<double>& temperatures, const FieldStats& stats) {
+    store_frame(time, temperatures, &stats);
+}
+
+void ResultWriter::store_frame(double time, const vector<double>& temperatures, const FieldStats* known_stats) {
+    bool due = is_frame_due(time);
+    ++steps_offered;
+    last_offered_time = time;
+    if (!due || !file.is_open()) {
+        return;
+    }
+    FieldStats stats = known_stats != nullptr ? *known_stats : compute_field_stats(temperatures);
+
+    unique_lock<mutex> lock(buffer_mutex);
+    buffer_free.wait(lock, [this] { return !has_pending; });
+    pending_time = time;
+    pending_stats = stats;
+    if (!options.probes.empty()) {
+        for (int64_t k = 0; k < values_count; ++k) {
+            int32_t node = options.probes[k];
+            pending_frame[k] = temperatures[node_order != nullptr ? node_order[node] : node];
+        }
+    } else if (values_count == 0) {
+        // Only the statistics are stored.
+    } else if (node_order != nullptr) {
+        for (int64_t i = 0; i < nodes_count; ++i) {
+            pending_frame[i] = temperatures[node_order[i]];
+        }
+    } else {
+        std::copy(temperatures.begin(), temperatures.begin() + nodes_count, pending_frame.begin());
+    }
+    has_pending = true;
+    lock.unlock();
+    buffer_ready.notify_one();
+}
+
+void ResultWriter::run() {
+    while (true) {
+        unique_lock<mutex> lock(buffer_mutex);
+        buffer_ready.wait(lock, [this] { return has_pending || stopping; });
+        if (!has_pending) {
+            return;
+        }
+        swap(pending_frame, writing_frame);
+        writing_time = pending_time;
+        writing_stats = pending_stats;
+        has_pending = false;
+        writing = true;
+        lock.unlock();
+        buffer_free.notify_all();
+
+        write_frame_to_disk();
+
+        lock.lock();
+        writing = false;
+        lock.unlock();
+        buffer_free.notify_all();
+    }
+}
+
+void ResultWriter::write_frame_to_disk() {
+    if (format == ResultFormat::Binary) {
+        file.write(reinterpret_cast<const char*>(&writing_time), sizeof(writing_time));
+        if (!options.fields) {
+            double summary[3] = { writing_stats.min, writing_stats.max, writing_stats.mean };
+            file.write(reinterpret_cast<const char*>(summary), sizeof(summary));
+        } else if (options.encoding == FrameEncoding::Float) {
+            encoded.resize(values_count * sizeof(float));
+            for (int64_t i = 0; i < values_count; ++i) {
+                float value = static_cast<float>(writing_frame[i]);
+                memcpy(&encoded[i * sizeof(float)], &value, sizeof(float));
+            }
+            file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+        } else if (options.encoding == FrameEncoding::Delta) {
+            write_delta_frame();
+        } else {
+            file.write(reinterpret_cast<const char*>(writing_frame.data()), values_count * sizeof(double));
+        }
+    } else {
+        file << "Time: " << writing_time << " s\n";
+        if (options.fields) {
+            file << "Temperatures: ";
+            for (const auto& temp : writing_frame) {
+                file << temp << " ";
+            }
+            file << "\n";
+        }
+        file << "Minimum Temperature: " << writing_stats.min << "\n";
+        file << "Maximum Temperature: " << writing_stats.max << "\n";
+        if (!options.fields || !options.probes.empty()) {
+            file << "Mean Temperature: " << writing_stats.mean << "\n";
+        }
+        file << "\n";
+    }
+    ++steps_written;
+}
+
+void ResultWriter::write_delta_frame() {
+    int32_t key = frames_since_key % delta_key_interval == 0 ? 1 : 0;
+    encoded.clear();
+    for (int64_t i = 0; i < values_count; ++i) {
+        int64_t quantized = llround(writing_frame[i] / options.delta_resolution);
+        int64_t delta = key ? quantized : quantized - previous_quantized[i];
+        previous_quantized[i] = quantized;
+        uint64_t zigzag = (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63);
+        while (zigzag >= 0x80) {
+            encoded.push_back(static_cast<uint8_t>(zigzag | 0x80));
+            zigzag >>= 7;
+        }
+        encoded.push_back(static_cast<uint8_t>(zigzag));
+    }
+    int32_t bytes = encoded.size();
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+    file.write(reinterpret_cast<const char*>(encoded.data()), bytes);
+    ++frames_since_key;
+}
+
+void ResultWriter::close() {
+    if (writer_thread.joinable()) {
+        {
+            lock_guard<mutex> lock(buffer_mutex);
+            stopping = true;
+        }
+        buffer_ready.notify_one();
+        writer_thread.join();
+    }
+
+    if (!file.is_open()) {
+        return;
+    }
+    if (format == ResultFormat::Binary) {
+        file.seekp(sizeof(binary_magic) + sizeof(int64_t) + sizeof(double));
+        file.write(reinterpret_cast<const char*>(&steps_written), sizeof(steps_written));
+    }
+    file.close();
+}
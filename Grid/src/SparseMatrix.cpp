@@ -0,0 +1,206 @@
+#include "SparseMatrix.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::vector;
+using std::ostream;
+using std::sort;
+using std::unique;
+using std::lower_bound;
+using std::fill;
+
+SparseMatrix::SparseMatrix() : n(0) {}
+
+// Two passes over the connectivity into one flat array (count, then fill), so the pattern is
+// built without a per-node allocation; each row is then sorted and compacted in place.
+void SparseMatrix::build_pattern(const int32_t* connectivity, int elements_count, int nodes_per_element, int nodes_num) {
+    n = nodes_num;
+    row_ptr.assign(n + 1, 0);
+
+    for (int e = 0; e < elements_count; ++e) {
+        const int32_t* ID = &connectivity[static_cast<size_t>(e) * nodes_per_element];
+        for (int i = 0; i < nodes_per_element; ++i) {
+            if (ID[i] < 0 || ID[i] >= n) {
+                cerr << "Invalid global index: " << ID[i] << endl;
+                continue;
+            }
+            for (int j = 0; j < nodes_per_element; ++j) {
+                if (ID[j] >= 0 && ID[j] < n) {
+                    row_ptr[ID[i] + 1]++;
+                }
+            }
+        }
+    }
+    for (int row = 0; row < n; ++row) {
+        row_ptr[row + 1] += row_ptr[row];
+    }
+
+    vector<int> fill_ptr(row_ptr.begin(), row_ptr.end() - 1);
+    col_idx.assign(row_ptr[n], 0);
+    for (int e = 0; e < elements_count; ++e) {
+        const int32_t* ID = &connectivity[static_cast<size_t>(e) * nodes_per_element];
+        for (int i = 0; i < nodes_per_element; ++i) {
+            if (ID[i] < 0 || ID[i] >= n) {
+                continue;
+            }
+            for (int j = 0; j < nodes_per_element; ++j) {
+                if (ID[j] >= 0 && ID[j] < n) {
+                    col_idx[fill_ptr[ID[i]]++] = ID[j];
+                }
+            }
+        }
+    }
+
+    int write = 0;
+    for (int row = 0; row < n; ++row) {
+        auto begin = col_idx.begin() + row_ptr[row];
+        auto end = col_idx.begin() + row_ptr[row + 1];
+        sort(begin, end);
+        int row_start = write;
+        for (auto it = begin; it != end; ++it) {
+            if (write == row_start || col_idx[write - 1] != *it) {
+                col_idx[write++] = *it;
+            }
+        }
+        row_ptr[row] = row_start;
+    }
+    row_ptr[n] = write;
+    col_idx.resize(write);
+    col_idx.shrink_to_fit();
+    values.assign(col_idx.size(), 0.0);
+}
+
+bool SparseMatrix::same_pattern(const SparseMatrix& other) const {
+    return n == other.n && row_ptr == other.row_ptr && col_idx == other.col_idx;
+}
+
+int SparseMatrix::find(int row, int col) const {
+    auto begin = col_idx.begin() + row_ptr[row];
+    auto end = col_idx.begin() + row_ptr[row + 1];
+    auto it = lower_bound(begin, end, col);
+    if (it == end || *it != col) {
+        return -1;
+    }
+    return it - col_idx.begin();
+}
+
+void SparseMatrix::add(int row, int col, double value) {
+    if (row < 0 || row >= n || col < 0 || col >= n) {
+        cerr << "Invalid global index: " << row << " or " << col << endl;
+        return;
+    }
+    int k = find(row, col);
+    if (k < 0) {
+        cerr << "Entry (" << row << ", " << col << ") is outside the sparsity pattern." << endl;
+        return;
+    }
+    values[k] += value;
+}
+
+double SparseMatrix::get(int row, int col) const {
+    int k = find(row, col);
+    return k < 0 ? 0.0 : values[k];
+}
+
+void SparseMatrix::set_zero() {
+    fill(values.begin(), values.end(), 0.0);
+}
+
+void SparseMatrix::scale(double factor) {
+    for (auto& value : values) {
+        value *= factor;
+    }
+}
+
+void SparseMatrix::add_scaled(const SparseMatrix& other, double factor) {
+    if (!same_pattern(other)) {
+        cerr << "Error: matrices have different sparsity patterns." << endl;
+        return;
+    }
+    for (size_t k = 0; k < values.size(); ++k) {
+        values[k] += factor * other.values[k];
+    }
+}
+
+void SparseMatrix::multiply(const vector<double>& x, vector<double>& y) const {
+    y.assign(n, 0.0);
+    for (int row = 0; row < n; ++row) {
+        double sum = 0.0;
+        for (int k = row_ptr[row]; k < row_ptr[row + 1]; ++k) {
+            sum += values[k] * x[col_idx[k]];
+        }
+        y[row] = sum;
+    }
+}
+
+void SparseMatrix::multiply_block(const vector<double>& X, vector<double>& Y, int rhs_count) const {
+    Y.assign(static_cast<size_t>(n) * rhs_count, 0.0);
+    for (int row = 0; row < n; ++row) {
+        double* y_row = &Y[static_cast<size_t>(row) * rhs_count];
+        for (int k = row_ptr[row]; k < row_ptr[row + 1]; ++k) {
+            double value = values[k];
+            const double* x_row = &X[static_cast<size_t>(col_idx[k]) * rhs_count];
+            for (int r = 0; r < rhs_count; ++r) {
+                y_row[r] += value * x_row[r];
+            }
+        }
+    }
+}
+
+void SparseMatrix::apply(const vector<double>& x, vector<double>& y) const {
+    multiply(x, y);
+}
+
+void SparseMatrix::get_diagonal(vector<double>& diagonal) const {
+    diagonal.assign(n, 0.0);
+    for (int row = 0; row < n; ++row) {
+        int k = find(row, row);
+        if (k >= 0) {
+            diagonal[row] = values[k];
+        }
+    }
+}
+
+int SparseMatrix::size() const { return n; }
+int SparseMatrix::nnz() const { return values.size(); }
+const vector<int>& SparseMatrix::get_row_ptr() const { return row_ptr; }
+const vector<int>& SparseMatrix::get_col_idx() const { return col_idx; }
+const vector<double>& SparseMatrix::get_values() const { return values; }
+vector<double>& SparseMatrix::get_values() { return values; }
+
+vector<vector<double>> SparseMatrix::to_dense() const {
+    vector<vector<double>> dense(n, vector<double>(n, 0.0));
+    for (int row = 0; row < n; ++row) {
+        for (int k = row_ptr[row]; k < row_ptr[row + 1]; ++k) {
+            dense[row][col_idx[k]] = values[k];
+        }
+    }
+    return dense;
+}
+
+void SparseMatrix::write(ostream& out) const {
+    out << "Size: " << n << " x " << n << ", nonzeros: " << nnz() << endl << endl;
+    for (int row = 0; row < n; ++row) {
+        for (int k = row_ptr[row]; k < row_ptr[row + 1]; ++k) {
+            out << row << " " << col_idx[k] << " " << values[k] << endl;
+        }
+    }
+}
+
+void SparseMatrix::display() const {
+    for (int row = 0; row < n; ++row) {
+        int k = row_ptr[row];
+        for (int col = 0; col < n; ++col) {
+            if (k < row_ptr[row + 1] && col_idx[k] == col) {
+                cout << values[k++] << " ";
+            } else {
+                cout << 0.0 << " ";
+            }
+        }
+        cout << endl;
+    }
+}
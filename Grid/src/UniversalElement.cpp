@@ -0,0 +1,76 @@
+#include "UniversalElement.h"
+#include "Integration.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using std::vector;
+using std::map;
+using std::unique_ptr;
+using std::make_unique;
+using std::mutex;
+using std::lock_guard;
+using std::invalid_argument;
+using std::to_string;
+
+UniversalElement::UniversalElement(int p_order) : order(p_order) {
+    if (!Integration::is_supported_order(order)) {
+        throw invalid_argument("Unsupported integration order: " + to_string(order));
+    }
+    Integration integrator;
+    vector<double> points = integrator.get_points(order);
+    vector<double> point_weights = integrator.get_weights(order);
+    int points_count = order * order;
+
+    weights.resize(points_count);
+    N.resize(4 * points_count);
+    dN_dxi.resize(4 * points_count);
+    dN_deta.resize(4 * points_count);
+
+    for (int i = 0; i < order; ++i) {
+        for (int j = 0; j < order; ++j) {
+            int p = i * order + j;
+            double xi = points[i];
+            double eta = points[j];
+            weights[p] = point_weights[i] * point_weights[j];
+
+            N[p * 4 + 0] = 0.25 * (1 - xi) * (1 - eta);
+            N[p * 4 + 1] = 0.25 * (1 + xi) * (1 - eta);
+            N[p * 4 + 2] = 0.25 * (1 + xi) * (1 + eta);
+            N[p * 4 + 3] = 0.25 * (1 - xi) * (1 + eta);
+
+            dN_dxi[p * 4 + 0] = -0.25 * (1 - eta);
+            dN_dxi[p * 4 + 1] =  0.25 * (1 - eta);
+            dN_dxi[p * 4 + 2] =  0.25 * (1 + eta);
+            dN_dxi[p * 4 + 3] = -0.25 * (1 + eta);
+
+            dN_deta[p * 4 + 0] = -0.25 * (1 - xi);
+            dN_deta[p * 4 + 1] = -0.25 * (1 + xi);
+            dN_deta[p * 4 + 2] =  0.25 * (1 + xi);
+            dN_deta[p * 4 + 3] =  0.25 * (1 - xi);
+        }
+    }
+}
+
+const UniversalElement& UniversalElement::get(int order) {
+    static map<int, unique_ptr<UniversalElement>> cache;
+    static mutex cache_mutex;
+
+    lock_guard<mutex> lock(cache_mutex);
+    auto& entry = cache[order];
+    if (!entry) {
+        entry = make_unique<UniversalElement>(order);
+    }
+    return *entry;
+}
+
+int UniversalElement::get_order() const { return order; }
+int UniversalElement::get_points_count() const { return order * order; }
+double UniversalElement::get_weight(int point) const { return weights[point]; }
+const double* UniversalElement::get_weights() const { return weights.data(); }
+const double* UniversalElement::get_N(int point) const { return &N[point * 4]; }
+const double* UniversalElement::get_dN_dxi(int point) const { return &dN_dxi[point * 4]; }
+const double* UniversalElement::get_dN_deta(int point) const { return &dN_deta[point * 4]; }
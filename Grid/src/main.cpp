@@ -1,47 +1,647 @@
+#include <chrono>
 #include <iostream>
 #include <math.h>
+#include <sstream>
 #include <vector>
+#include <string>
 #include "GlobalData.h"
 #include "FEMSolver.h"
 #include "Grid.h"
 #include "Integration.h"
 #include "Element.h"
+#include "SparseMatrix.h"
+#include "LinearSolver.h"
+#include "Logger.h"
+#include "Profiler.h"
+#ifdef FEM_MPI
+#include <mpi.h>
+#include "DistributedSolver.h"
+#endif
+#ifdef FEM_OFFLOAD
+#include "DeviceSolver.h"
+#endif
 
 using std::cout;
+using std::cerr;
 using std::endl;
 using std::vector;
+using std::string;
+using std::stod;
+using std::stoi;
+using std::stringstream;
+using std::getline;
+using std::cin;
+using std::flush;
+
+#ifdef FEM_MPI
+struct MPISession {
+    int rank = 0, ranks_count = 1;
+    MPISession(int& argc, char**& argv) {
+        MPI_Init(&argc, &argv);
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &ranks_count);
+    }
+    ~MPISession() { MPI_Finalize(); }
+};
+#endif
+
+// Whole-string option values: "12abc" is rejected like "abc".
+bool parse_number(const string& text, int& value) {
+    size_t end = 0;
+    try {
+        value = stoi(text, &end);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return end == text.size();
+}
+
+bool parse_number(const string& text, double& value) {
+    size_t end = 0;
+    try {
+        value = stod(text, &end);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return end == text.size();
+}
+
+// Comma separated node IDs, e.g. "0,15,42".
+bool parse_node_list(const string& text, vector<int32_t>& nodes) {
+    stringstream stream(text);
+    string item;
+    nodes.clear();
+    while (getline(stream, item, ',')) {
+        size_t end = 0;
+        try {
+            nodes.push_back(stoi(item, &end));
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (end != item.size()) {
+            return false;
+        }
+    }
+    return !nodes.empty();
+}
+
+// Writes the profile, also of a failed run; the exit status is 1 if the run or the profile failed.
+int finish_run(const string& profile_path, bool succeeded = true) {
+    int status = succeeded ? 0 : 1;
+    if (profile_path.empty()) {
+        return status;
+    }
+#ifdef FEM_PROFILING
+    return Profiler::write(profile_path) ? status : 1;
+#else
+    cerr << "Profiling is not compiled in (build with -DFEM_PROFILING), " << profile_path << " was not written." << endl;
+    return status;
+#endif
+}
+
+// Long-running mode: one command per line on stdin, one reply line on stdout, until "quit" or
+// the end of input. "solve [name=value ...]" runs a transient solve with the data.txt values,
+// overridden by conductivity, density, specific_heat, alfa, ambient_temp, initial_temp,
+// step_time or simulation_time, and replies
+//   ok time=<s> min=<K> max=<K> mean=<K> factorized=<0|1> seconds=<wall time>
+// or "error <message>". The mesh and unit operators stay loaded between requests.
+int run_service(FEMSolver& solver, GlobalData& data) {
+    string line;
+    while (getline(cin, line)) {
+        stringstream stream(line);
+        string command;
+        if (!(stream >> command)) {
+            continue;
+        }
+        if (command == "quit") {
+            break;
+        }
+        if (command != "solve") {
+            cout << "error unknown command: " << command << endl;
+            continue;
+        }
+
+        double conductivity = data.get_conductivity(), density = data.get_density(), specific_heat = data.get_specific_heat();
+        SolveRequest request = { 0.0, 0.0, data.get_alfa(), data.get_ambient_temp(), data.get_initial_temp(), data.get_simulation_step_time(),
+                                 data.get_simulation_time() };
+        string item, error;
+        while (error.empty() && stream >> item) {
+            size_t separator = item.find('=');
+            string name = item.substr(0, separator);
+            double value = 0.0;
+            size_t end = 0;
+            try {
+                value = separator == string::npos ? 0.0 : stod(item.substr(separator + 1), &end);
+            } catch (const std::exception&) {
+                end = 0;
+            }
+            if (separator == string::npos || end == 0 || separator + 1 + end != item.size()) {
+                error = "invalid parameter: " + item;
+            } else if (name == "conductivity") {
+                conductivity = value;
+            } else if (name == "density") {
+                density = value;
+            } else if (name == "specific_heat") {
+                specific_heat = value;
+            } else if (name == "alfa") {
+                request.alpha = value;
+            } else if (name == "ambient_temp") {
+                request.ambient_temperature = value;
+            } else if (name == "initial_temp") {
+                request.initial_temperature = value;
+            } else if (name == "step_time") {
+                request.time_step = value;
+            } else if (name == "simulation_time") {
+                request.total_time = value;
+            } else {
+                error = "unknown parameter: " + name;
+            }
+        }
+        if (error.empty() && (conductivity <= 0 || density <= 0 || specific_heat <= 0 || request.alpha <= 0 || request.time_step <= 0
+                              || request.total_time < 0)) {
+            error = "conductivity, density, specific_heat, alfa and step_time must be positive, simulation_time not negative";
+        }
+        if (!error.empty()) {
+            cout << "error " << error << endl;
+            continue;
+        }
+        request.conductivity = conductivity;
+        request.density_specific_heat = density * specific_heat;
+
+        auto start = std::chrono::steady_clock::now();
+        int factorizations = solver.get_session_factorizations();
+        vector<double> t_final;
+        if (!solver.solve(request, t_final)) {
+            cout << "error solve failed" << endl;
+            continue;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        FieldStats stats = compute_field_stats(t_final);
+        cout << "ok time=" << floor(request.total_time / request.time_step + 1e-9) * request.time_step << " min=" << stats.min
+             << " max=" << stats.max << " mean=" << stats.mean << " factorized=" << solver.get_session_factorizations() - factorizations
+             << " seconds=" << seconds << endl << flush;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+#ifdef FEM_MPI
+    MPISession mpi(argc, argv);
+#endif
+    SolverType solver_type = SolverType::LDLT;
+    double solver_tolerance = 1e-10;
+    int solver_max_iterations = 1000;
+    int integration_order = 16;
+    int thread_count = 1;
+    AssemblyMode assembly_mode = AssemblyMode::Serial;
+    ResultFormat result_format = ResultFormat::Text;
+    OutputOptions output_options;
+    KernelType kernel_type = KernelType::Auto;
+    MeshSource mesh_source = MeshSource::File;
+    ElementType element_type = ElementType::Quad4;
+    string data_directory = "../Grid/data";
+    string results_directory = "../Grid/results";
+    bool service = false;
+    string mesh_path;
+    string write_mesh_path;
+    bool matrix_free = false;
+    bool offload = false;
+    bool reorder_nodes = false;
+    MassMatrix mass_matrix = MassMatrix::Consistent;
+    TimeScheme time_scheme = TimeScheme::Implicit;
+    bool adaptive_stepping = false;
+    double step_tolerance = 0.5;
+    double max_time_step = 0.0;
+    string scenarios_path;
+    string material_path;
+    double nonlinear_tolerance = 1e-4;
+    int nonlinear_max_iterations = 25;
+    double reassembly_tolerance = 0.01;
+    bool write_intermediate = true;
+    string profile_path;
+    string checkpoint_path, restart_path;
+    int checkpoint_interval = 100;
+
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool valid = true;
+        if (arg == "--solver" && i + 1 < argc) {
+            if (!parse_solver_type(argv[++i], solver_type)) {
+                cerr << "Unknown solver: " << argv[i] << " (expected ldlt, banded, pcg-jacobi or pcg-ic0)" << endl;
+                return 1;
+            }
+        } else if (arg == "--tolerance" && i + 1 < argc) {
+            valid = parse_number(argv[++i], solver_tolerance);
+        } else if (arg == "--max-iterations" && i + 1 < argc) {
+            valid = parse_number(argv[++i], solver_max_iterations);
+        } else if (arg == "--integration-order" && i + 1 < argc) {
+            valid = parse_number(argv[++i], integration_order);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            valid = parse_number(argv[++i], thread_count);
+        } else if (arg == "--assembly" && i + 1 < argc) {
+            string mode = argv[++i];
+            if (mode == "serial") {
+                assembly_mode = AssemblyMode::Serial;
+            } else if (mode == "colored") {
+                assembly_mode = AssemblyMode::Colored;
+            } else if (mode == "buffers") {
+                assembly_mode = AssemblyMode::ThreadBuffers;
+            } else {
+                cerr << "Unknown assembly mode: " << mode << " (expected serial, colored or buffers)" << endl;
+                return 1;
+            }
+        } else if (arg == "--output" && i + 1 < argc) {
+            string format = argv[++i];
+            if (format == "text") {
+                result_format = ResultFormat::Text;
+            } else if (format == "binary") {
+                result_format = ResultFormat::Binary;
+            } else {
+                cerr << "Unknown output format: " << format << " (expected text or binary)" << endl;
+                return 1;
+            }
+        } else if (arg == "--output-every" && i + 1 < argc) {
+            valid = parse_number(argv[++i], output_options.every_steps);
+        } else if (arg == "--output-interval" && i + 1 < argc) {
+            valid = parse_number(argv[++i], output_options.every_time);
+        } else if (arg == "--probes" && i + 1 < argc) {
+            if (!parse_node_list(argv[++i], output_options.probes)) {
+                cerr << "Invalid probe list: " << argv[i] << " (expected node IDs separated by commas)" << endl;
+                return 1;
+            }
+        } else if (arg == "--fields" && i + 1 < argc) {
+            string fields = argv[++i];
+            if (fields == "all") {
+                output_options.fields = true;
+            } else if (fields == "none") {
+                output_options.fields = false;
+            } else {
+                cerr << "Unknown fields mode: " << fields << " (expected all or none)" << endl;
+                return 1;
+            }
+        } else if (arg == "--precision" && i + 1 < argc) {
+            string precision = argv[++i];
+            if (precision == "double") {
+                output_options.encoding = FrameEncoding::Double;
+            } else if (precision == "float") {
+                output_options.encoding = FrameEncoding::Float;
+            } else if (precision == "delta") {
+                output_options.encoding = FrameEncoding::Delta;
+            } else {
+                cerr << "Unknown precision: " << precision << " (expected double, float or delta)" << endl;
+                return 1;
+            }
+        } else if (arg == "--delta-resolution" && i + 1 < argc) {
+            valid = parse_number(argv[++i], output_options.delta_resolution);
+        } else if (arg == "--kernel" && i + 1 < argc) {
+            if (!parse_kernel_type(argv[++i], kernel_type)) {
+                cerr << "Unknown kernel: " << argv[i] << " (expected auto, scalar, avx2 or avx512)" << endl;
+                return 1;
+            }
+        } else if (arg == "--mesh" && i + 1 < argc) {
+            string source = argv[++i];
+            if (source == "file") {
+                mesh_source = MeshSource::File;
+            } else if (source == "generated") {
+                mesh_source = MeshSource::Generated;
+            } else {
+                cerr << "Unknown mesh source: " << source << " (expected file or generated)" << endl;
+                return 1;
+            }
+        } else if (arg == "--element" && i + 1 < argc) {
+            if (!parse_element_type(argv[++i], element_type)) {
+                cerr << "Unknown element type: " << argv[i] << " (expected quad4, quad8, quad9 or tri3)" << endl;
+                return 1;
+            }
+        } else if (arg == "--data-dir" && i + 1 < argc) {
+            data_directory = argv[++i];
+        } else if (arg == "--results-dir" && i + 1 < argc) {
+            results_directory = argv[++i];
+        } else if (arg == "--service") {
+            service = true;
+        } else if (arg == "--mesh-file" && i + 1 < argc) {
+            mesh_path = argv[++i];
+        } else if (arg == "--write-mesh" && i + 1 < argc) {
+            write_mesh_path = argv[++i];
+        } else if (arg == "--reorder" && i + 1 < argc) {
+            string ordering = argv[++i];
+            if (ordering == "rcm") {
+                reorder_nodes = true;
+            } else if (ordering == "none") {
+                reorder_nodes = false;
+            } else {
+                cerr << "Unknown node ordering: " << ordering << " (expected none or rcm)" << endl;
+                return 1;
+            }
+        } else if (arg == "--matrix-free") {
+            matrix_free = true;
+        } else if (arg == "--offload") {
+            offload = true;
+        } else if (arg == "--mass" && i + 1 < argc) {
+            string mass = argv[++i];
+            if (mass == "consistent") {
+                mass_matrix = MassMatrix::Consistent;
+            } else if (mass == "lumped") {
+                mass_matrix = MassMatrix::Lumped;
+            } else {
+                cerr << "Unknown mass matrix: " << mass << " (expected consistent or lumped)" << endl;
+                return 1;
+            }
+        } else if (arg == "--time-scheme" && i + 1 < argc) {
+            string scheme = argv[++i];
+            if (scheme == "implicit") {
+                time_scheme = TimeScheme::Implicit;
+            } else if (scheme == "explicit") {
+                time_scheme = TimeScheme::Explicit;
+            } else {
+                cerr << "Unknown time scheme: " << scheme << " (expected implicit or explicit)" << endl;
+                return 1;
+            }
+        } else if (arg == "--adaptive") {
+            adaptive_stepping = true;
+        } else if (arg == "--step-tolerance" && i + 1 < argc) {
+            valid = parse_number(argv[++i], step_tolerance);
+        } else if (arg == "--max-step" && i + 1 < argc) {
+            valid = parse_number(argv[++i], max_time_step);
+        } else if (arg == "--scenarios" && i + 1 < argc) {
+            scenarios_path = argv[++i];
+        } else if (arg == "--material" && i + 1 < argc) {
+            material_path = argv[++i];
+        } else if (arg == "--nonlinear-tolerance" && i + 1 < argc) {
+            valid = parse_number(argv[++i], nonlinear_tolerance);
+        } else if (arg == "--nonlinear-iterations" && i + 1 < argc) {
+            valid = parse_number(argv[++i], nonlinear_max_iterations);
+        } else if (arg == "--reassembly-tolerance" && i + 1 < argc) {
+            valid = parse_number(argv[++i], reassembly_tolerance);
+        } else if (arg == "--no-intermediate") {
+            write_intermediate = false;
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_path = argv[++i];
+        } else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+            valid = parse_number(argv[++i], checkpoint_interval);
+        } else if (arg == "--restart" && i + 1 < argc) {
+            restart_path = argv[++i];
+        } else if (arg == "--profile" && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            string level = argv[++i];
+            if (level == "quiet") {
+                Logger::set_level(LogLevel::Quiet);
+            } else if (level == "info") {
+                Logger::set_level(LogLevel::Info);
+            } else if (level == "debug") {
+                Logger::set_level(LogLevel::Debug);
+            } else {
+                cerr << "Unknown log level: " << level << " (expected quiet, info or debug)" << endl;
+                return 1;
+            }
+        } else {
+            cerr << "Unknown option: " << arg << endl;
+            return 1;
+        }
+        if (!valid) {
+            cerr << "Invalid value for " << arg << ": " << argv[i] << endl;
+            return 1;
+        }
+    }
+    if (solver_tolerance <= 0.0 || solver_max_iterations < 1 || thread_count < 1) {
+        cerr << "--tolerance must be positive, --max-iterations and --threads at least 1." << endl;
+        return 1;
+    }
+    if (step_tolerance <= 0.0 || max_time_step < 0.0) {
+        cerr << "--step-tolerance must be positive and --max-step not negative." << endl;
+        return 1;
+    }
+    if (!checkpoint_path.empty() && checkpoint_interval < 1) {
+        cerr << "--checkpoint-interval must be at least 1." << endl;
+        return 1;
+    }
+    if (!Integration::is_supported_order(integration_order)) {
+        cerr << "Unsupported --integration-order: " << integration_order << " (expected 2, 3, 4, 9 or 16)" << endl;
+        return 1;
+    }
+    if (output_options.every_steps < 1 || output_options.every_time < 0.0 || output_options.delta_resolution <= 0.0) {
+        cerr << "--output-every must be at least 1, --output-interval and --delta-resolution must be positive." << endl;
+        return 1;
+    }
+    if (output_options.encoding != FrameEncoding::Double && result_format == ResultFormat::Text) {
+        cerr << "--precision applies to binary output only (--output binary), text results keep 5 decimals." << endl;
+    }
+
+    // Replies are the only output of the service on stdout.
+    if (service) {
+        Logger::set_level(LogLevel::Quiet);
+    }
+
+#ifdef FEM_MPI
+    if (mpi.rank != 0) {
+        Logger::set_level(LogLevel::Quiet);
+        write_mesh_path.clear();
+        profile_path.clear();
+    }
+#endif
 
-int main() {
     GlobalData data;
-    data.read_file();
+    if (!data.read_file(data_directory)) {
+        return 1;
+    }
+    if (mesh_path.empty()) {
+        mesh_path = data_directory + "/xy_nodes.txt";
+    }
+    Material material = { data.get_conductivity(), data.get_density(), data.get_specific_heat() };
+    if (!material_path.empty() && !GlobalData::read_material(material_path, material)) {
+        return 1;
+    }
+    bool nonlinear = !material.is_constant();
+    if (nonlinear && (nonlinear_tolerance <= 0.0 || nonlinear_max_iterations < 1 || reassembly_tolerance < 0.0)) {
+        cerr << "--nonlinear-tolerance must be positive, --nonlinear-iterations at least 1 and --reassembly-tolerance not negative." << endl;
+        return 1;
+    }
+
+    Grid grid(data.get_nN(), data.get_nE(), data.get_nW(), data. get_nH(), data.get_height(), data.get_width(), mesh_source, mesh_path,
+              element_type);
+    if (grid.get_elements_count() == 0) {
+        cerr << "Error: The mesh has no elements." << endl;
+        return 1;
+    }
+    for (int32_t probe : output_options.probes) {
+        if (probe < 0 || probe >= grid.get_nodes_count()) {
+            cerr << "Error: probe node " << probe << " is outside the mesh (" << grid.get_nodes_count() << " nodes)." << endl;
+            return 1;
+        }
+    }
+    if (!write_mesh_path.empty() && !grid.write_binary_mesh(write_mesh_path)) {
+        return 1;
+    }
+    if (reorder_nodes) {
+        int bandwidth = grid.get_bandwidth();
+        grid.reorder_nodes();
+        if (Logger::enabled(LogLevel::Info)) {
+            cout << "RCM node renumbering: bandwidth " << bandwidth << " -> " << grid.get_bandwidth() << endl;
+        }
+    }
+    if (Logger::enabled(LogLevel::Info)) {
+        data.display_simulation_data();
+    }
+    if (Logger::enabled(LogLevel::Debug)) {
+        grid.display_grid_data();
+    }
+
+    if (nonlinear && (offload || !scenarios_path.empty())) {
+        cerr << "Temperature-dependent materials are not supported with --offload or --scenarios." << endl;
+        return 1;
+    }
+    if (service && (offload || nonlinear || !scenarios_path.empty())) {
+        cerr << "--service is not supported with --offload, --scenarios or temperature-dependent materials." << endl;
+        return 1;
+    }
+
+#ifdef FEM_MPI
+    if (mpi.ranks_count > 1) {
+        if (nonlinear || service) {
+            cerr << "Temperature-dependent materials and --service are not supported in MPI runs." << endl;
+            return 1;
+        }
+        if (mpi.rank == 0 && (matrix_free || time_scheme != TimeScheme::Implicit || adaptive_stepping || !scenarios_path.empty()
+                              || !checkpoint_path.empty() || !restart_path.empty() || solver_type != SolverType::PCG_Jacobi)) {
+            cerr << "MPI runs use fixed implicit steps with Jacobi PCG, other solver and stepping options are ignored." << endl;
+        }
+        DistributedSolver distributed(grid, MPI_COMM_WORLD, data.get_alfa(), thread_count);
+        if (Logger::enabled(LogLevel::Info)) {
+            cout << "MPI: " << mpi.ranks_count << " ranks, rank 0 owns " << distributed.get_owned_count() << " nodes and "
+                 << distributed.get_ghost_count() << " ghost nodes" << endl;
+        }
+        distributed.set_solver(solver_tolerance, solver_max_iterations);
+        distributed.set_results_directory(results_directory);
+        distributed.assemble(data.get_conductivity(), data.get_density(), data.get_specific_heat(), data.get_alfa(), data.get_ambient_temp());
+        bool succeeded = distributed.simulate_time(data.get_initial_temp(), data.get_simulation_step_time(), data.get_simulation_time(),
+                                                   result_format, output_options);
+        return finish_run(profile_path, succeeded);
+    }
+#endif
 
-    Grid grid(data.get_nN(), data.get_nE(), data.get_nW(), data. get_nH(), data.get_height(), data.get_width());
-    data.display_simulation_data();
-    grid.display_grid_data();
+    if (offload) {
+#ifdef FEM_OFFLOAD
+        if (grid.get_element_type() != ElementType::Quad4) {
+            cerr << "Offloaded runs support quad4 elements only." << endl;
+            return 1;
+        }
+        if (matrix_free || time_scheme != TimeScheme::Implicit || adaptive_stepping || !scenarios_path.empty()
+            || !checkpoint_path.empty() || !restart_path.empty() || solver_type != SolverType::PCG_Jacobi) {
+            cerr << "Offloaded runs use fixed implicit steps with Jacobi PCG, other solver and stepping options are ignored." << endl;
+        }
+        if (DeviceSolver::get_devices_count() == 0) {
+            cerr << "No offload device found, the device kernels run on the host." << endl;
+        }
+        DeviceSolver device(grid, integration_order);
+        device.set_solver(solver_tolerance, solver_max_iterations);
+        device.set_results_directory(results_directory);
+        if (!device.assemble(data.get_conductivity(), data.get_density() * data.get_specific_heat(), data.get_alfa(), data.get_ambient_temp())) {
+            return 1;
+        }
+        bool succeeded = device.simulate_time(data.get_initial_temp(), data.get_simulation_step_time(), data.get_simulation_time(), result_format,
+                                              output_options);
+        return finish_run(profile_path, succeeded);
+#else
+        cerr << "Offloading is not compiled in (build with -DFEM_OFFLOAD)." << endl;
+        return 1;
+#endif
+    }
 
     vector<double> P_global;
-    vector<vector<double>> H_global, C_global;
+    SparseMatrix H_global, C_global;
     double conductivity = data.get_conductivity();
     double density = data.get_density();
     double specific_heat = data.get_specific_heat();
-    double nN = data.get_nN();
+    int nN = grid.get_nodes_count();
     double init_temp = data.get_initial_temp();
     double time_step = data.get_simulation_step_time();
     double total_time = data.get_simulation_time();
     
     FEMSolver solver(grid, data.get_alfa(), data.get_ambient_temp());
-    solver.calculate_Hbc_matrix(conductivity); 
-    solver.aggregate_Hbc_matrix(H_global, data.get_nN());  
-    solver.calculate_C_matrix(density, specific_heat);
-    solver.aggregate_C_matrix(C_global, data.get_nN());
+    solver.set_solver(solver_type, solver_tolerance, solver_max_iterations);
+    if (!solver.set_integration_order(integration_order)) {
+        return 1;
+    }
+    solver.set_thread_count(thread_count);
+    solver.set_assembly_mode(assembly_mode);
+    solver.set_result_format(result_format);
+    solver.set_output_options(output_options);
+    solver.set_kernel(kernel_type);
+    solver.set_results_directory(results_directory);
+    if (time_scheme == TimeScheme::Explicit && mass_matrix == MassMatrix::Consistent) {
+        if (Logger::enabled(LogLevel::Info)) {
+            cout << "Explicit time stepping uses the lumped mass matrix." << endl;
+        }
+        mass_matrix = MassMatrix::Lumped;
+    }
+    solver.set_mass_matrix(mass_matrix);
+    solver.set_write_intermediate(write_intermediate);
+    if (adaptive_stepping && time_scheme == TimeScheme::Explicit) {
+        cerr << "Adaptive stepping is only available for the implicit scheme, using fixed steps." << endl;
+        adaptive_stepping = false;
+    }
+    solver.set_adaptive_stepping(adaptive_stepping, step_tolerance, max_time_step);
+    solver.set_checkpoint(checkpoint_path, checkpoint_interval);
+    solver.set_restart(restart_path);
+    if (service) {
+        if (matrix_free || time_scheme != TimeScheme::Implicit || adaptive_stepping || !checkpoint_path.empty() || !restart_path.empty()) {
+            cerr << "The service uses fixed implicit steps with assembled matrices, --matrix-free, --time-scheme, --adaptive and checkpoints are ignored." << endl;
+        }
+        solver.set_checkpoint("", 0);
+        solver.set_restart("");
+        run_service(solver, data);
+        return finish_run(profile_path);
+    }
+    if (!scenarios_path.empty()) {
+        if (!checkpoint_path.empty() || !restart_path.empty()) {
+            cerr << "Checkpoints are not supported for scenario sweeps." << endl;
+            return 1;
+        }
+        vector<Scenario> scenarios;
+        if (!GlobalData::read_scenarios(scenarios_path, scenarios)) {
+            return 1;
+        }
+        bool succeeded = solver.simulate_scenarios(scenarios, conductivity, density, specific_heat, time_step, total_time);
+        return finish_run(profile_path, succeeded);
+    }
+
+    if (nonlinear) {
+        if (matrix_free || time_scheme != TimeScheme::Implicit || adaptive_stepping) {
+            cerr << "Nonlinear runs use fixed implicit steps with assembled matrices, --matrix-free, --time-scheme and --adaptive are ignored." << endl;
+        }
+        solver.set_nonlinear(nonlinear_tolerance, nonlinear_max_iterations, reassembly_tolerance);
+        solver.calculate_P_vector(data.get_alfa(), data.get_ambient_temp());
+        solver.aggregate_P_vector(P_global, nN);
+        vector<double> t_initial(nN, init_temp);
+        bool succeeded = solver.simulate_time_nonlinear(material, P_global, t_initial, time_step, total_time);
+        return finish_run(profile_path, succeeded);
+    }
+
+    solver.calculate_local_matrices(conductivity, density, specific_heat);
+    if (!matrix_free) {
+        solver.aggregate_Hbc_matrix(H_global, nN);  
+        solver.aggregate_C_matrix(C_global, nN);
+    }
     solver.calculate_P_vector(data.get_alfa(), data.get_ambient_temp());
-    solver.aggregate_P_vector(P_global, data.get_nN());
+    solver.aggregate_P_vector(P_global, nN);
 
     vector<double> t_global;  
-    solver.solve_system(H_global, P_global, t_global);
-
     vector<double> t_initial(nN, init_temp);
-    solver.simulate_time(H_global, C_global, P_global, t_initial, time_step, total_time);
+    bool succeeded = matrix_free ? solver.solve_system(P_global, t_global) : solver.solve_system(H_global, P_global, t_global);
+    if (!succeeded) {
+        return finish_run(profile_path, false);
+    }
 
-    return 0;
+    if (time_scheme == TimeScheme::Explicit && matrix_free) {
+        succeeded = solver.simulate_time_explicit(P_global, t_initial, time_step, total_time);
+    } else if (time_scheme == TimeScheme::Explicit) {
+        succeeded = solver.simulate_time_explicit(H_global, P_global, t_initial, time_step, total_time);
+    } else if (matrix_free) {
+        succeeded = solver.simulate_time(P_global, t_initial, time_step, total_time);
+    } else {
+        succeeded = solver.simulate_time(H_global, C_global, P_global, t_initial, time_step, total_time);
+    }
+
+    return finish_run(profile_path, succeeded);
 }
\ No newline at end of file